@@ -0,0 +1,303 @@
+#include "AsyncFrameReader.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#ifdef _WIN32
+#define NOMINMAX
+#include <malloc.h>
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace {
+size_t roundUp(size_t size, size_t alignment)
+{
+    return (size + alignment - 1) / alignment * alignment;
+}
+
+uint8_t *allocateAligned(size_t size)
+{
+#ifdef _WIN32
+    void *data = _aligned_malloc(size, AsyncFrameReader::blockSize);
+#else
+    void *data = std::aligned_alloc(AsyncFrameReader::blockSize, size);
+#endif
+    if (!data) {
+        printf("Failed to allocate %zu bytes of read buffers\n", size);
+        exit(1);
+    }
+    return static_cast<uint8_t *>(data);
+}
+
+void freeAligned(uint8_t *data)
+{
+#ifdef _WIN32
+    _aligned_free(data);
+#else
+    std::free(data);
+#endif
+}
+
+#ifdef _WIN32
+// blocking read of the whole file, the size or a negative error number
+long long readFile(const std::string &path, uint8_t *data, size_t capacity)
+{
+    HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+                              OPEN_EXISTING, FILE_FLAG_NO_BUFFERING | FILE_FLAG_SEQUENTIAL_SCAN,
+                              nullptr);
+    if (file == INVALID_HANDLE_VALUE) {
+        return -static_cast<long long>(GetLastError());
+    }
+    size_t total = 0;
+    while (total < capacity) {
+        DWORD read = 0;
+        const DWORD chunk = static_cast<DWORD>(std::min<size_t>(capacity - total, 1u << 30));
+        if (!ReadFile(file, data + total, chunk, &read, nullptr)) {
+            const DWORD error = GetLastError();
+            CloseHandle(file);
+            return -static_cast<long long>(error);
+        }
+        if (!read) {
+            break;
+        }
+        total += read;
+    }
+    CloseHandle(file);
+    return static_cast<long long>(total);
+}
+#else
+// falls back to buffered reads on file systems without direct I/O, such as tmpfs
+int openFile(const std::string &path)
+{
+#ifdef O_DIRECT
+    const int file = open(path.c_str(), O_RDONLY | O_DIRECT);
+    if (file >= 0 || errno != EINVAL) {
+        return file;
+    }
+#endif
+    return open(path.c_str(), O_RDONLY);
+}
+
+#ifndef SYNCTEST_USE_IO_URING
+long long readFile(const std::string &path, uint8_t *data, size_t capacity)
+{
+    const int file = openFile(path);
+    if (file < 0) {
+        return -errno;
+    }
+    // direct reads stop short at the end of the file, the next one returns 0
+    size_t total = 0;
+    while (total < capacity) {
+        const ssize_t read = pread(file, data + total, capacity - total,
+                                   static_cast<off_t>(total));
+        if (read < 0) {
+            const int error = errno;
+            close(file);
+            return -error;
+        }
+        if (!read) {
+            break;
+        }
+        total += static_cast<size_t>(read);
+    }
+    close(file);
+    return static_cast<long long>(total);
+}
+#endif
+#endif
+} // namespace
+
+AsyncFrameReader::AsyncFrameReader(uint32_t buffers, size_t bufferSize, uint32_t threads)
+    : mSlots(buffers), mBufferSize(roundUp(bufferSize, blockSize))
+{
+    for (auto &slot : mSlots) {
+        slot.data = allocateAligned(mBufferSize);
+    }
+#ifdef SYNCTEST_USE_IO_URING
+    (void)threads;
+    if (const int error = io_uring_queue_init(buffers, &mRing, 0); error < 0) {
+        printf("io_uring_queue_init failed: %s\n", strerror(-error));
+        exit(1);
+    }
+#else
+    for (uint32_t i = 0; i < threads; ++i) {
+        mThreads.emplace_back([this]() { work(); });
+    }
+#endif
+}
+
+AsyncFrameReader::~AsyncFrameReader()
+{
+#ifdef SYNCTEST_USE_IO_URING
+    // the kernel writes into the buffers until the reads completed
+    for (uint32_t i = 0; i < mSlots.size(); ++i) {
+        if (pending(i)) {
+            wait(i);
+        }
+    }
+    io_uring_queue_exit(&mRing);
+#else
+    {
+        std::lock_guard guard(mMutex);
+        mStopping = true;
+        mQueue.clear();
+        mCond.notify_all();
+    }
+    for (auto &thread : mThreads) {
+        thread.join();
+    }
+#endif
+    for (auto &slot : mSlots) {
+        freeAligned(slot.data);
+    }
+}
+
+const char *AsyncFrameReader::backend() const
+{
+#ifdef SYNCTEST_USE_IO_URING
+    return "io_uring";
+#else
+    return "thread pool";
+#endif
+}
+
+bool AsyncFrameReader::pending(uint32_t buffer) const
+{
+    std::lock_guard guard(mMutex);
+    return mSlots[buffer].state == State::Queued;
+}
+
+#ifdef SYNCTEST_USE_IO_URING
+
+void AsyncFrameReader::submit(uint32_t buffer, const std::string &path)
+{
+    std::lock_guard guard(mMutex);
+    Slot &slot = mSlots[buffer];
+    slot.path = path;
+    slot.file = openFile(path);
+    if (slot.file < 0) {
+        printf("Failed to open %s: %s\n", path.c_str(), strerror(errno));
+        exit(1);
+    }
+    slot.result = 0;
+    slot.state = State::Queued;
+    queueRead(buffer);
+}
+
+void AsyncFrameReader::queueRead(uint32_t buffer)
+{
+    Slot &slot = mSlots[buffer];
+    const auto done = static_cast<size_t>(slot.result);
+    // the ring has an entry for every buffer, it cannot be full
+    io_uring_sqe *sqe = io_uring_get_sqe(&mRing);
+    io_uring_prep_read(sqe, slot.file, slot.data + done,
+                       static_cast<unsigned>(mBufferSize - done), done);
+    io_uring_sqe_set_data(sqe, reinterpret_cast<void *>(static_cast<uintptr_t>(buffer)));
+    io_uring_submit(&mRing);
+}
+
+void AsyncFrameReader::complete()
+{
+    io_uring_cqe *cqe = nullptr;
+    if (const int error = io_uring_wait_cqe(&mRing, &cqe); error < 0) {
+        printf("io_uring_wait_cqe failed: %s\n", strerror(-error));
+        exit(1);
+    }
+    const auto buffer =
+        static_cast<uint32_t>(reinterpret_cast<uintptr_t>(io_uring_cqe_get_data(cqe)));
+    Slot &slot = mSlots[buffer];
+    const int result = cqe->res;
+    io_uring_cqe_seen(&mRing, cqe);
+    // short reads continue where they stopped until the buffer is full or the file ends, as
+    // the thread pool does; interrupted reads are repeated
+    if (result == -EINTR || result == -EAGAIN) {
+        queueRead(buffer);
+        return;
+    }
+    if (result < 0) {
+        slot.result = result;
+    } else {
+        slot.result += result;
+        if (result > 0 && static_cast<size_t>(slot.result) < mBufferSize) {
+            queueRead(buffer);
+            return;
+        }
+    }
+    slot.state = State::Done;
+    close(slot.file);
+    slot.file = -1;
+}
+
+size_t AsyncFrameReader::wait(uint32_t buffer)
+{
+    std::lock_guard guard(mMutex);
+    Slot &slot = mSlots[buffer];
+    // completions arrive in any order, the ones of other buffers are kept for their wait
+    while (slot.state == State::Queued) {
+        complete();
+    }
+    slot.state = State::Idle;
+    if (slot.result < 0) {
+        printf("Failed to read %s: %s\n", slot.path.c_str(),
+               strerror(static_cast<int>(-slot.result)));
+        exit(1);
+    }
+    return static_cast<size_t>(slot.result);
+}
+
+#else
+
+void AsyncFrameReader::submit(uint32_t buffer, const std::string &path)
+{
+    std::lock_guard guard(mMutex);
+    Slot &slot = mSlots[buffer];
+    slot.path = path;
+    slot.state = State::Queued;
+    mQueue.push_back(buffer);
+    mCond.notify_all();
+}
+
+size_t AsyncFrameReader::wait(uint32_t buffer)
+{
+    std::unique_lock lock(mMutex);
+    Slot &slot = mSlots[buffer];
+    while (slot.state == State::Queued) {
+        mCond.wait(lock);
+    }
+    slot.state = State::Idle;
+    if (slot.result < 0) {
+        printf("Failed to read %s: error %lld\n", slot.path.c_str(), -slot.result);
+        exit(1);
+    }
+    return static_cast<size_t>(slot.result);
+}
+
+void AsyncFrameReader::work()
+{
+    std::unique_lock lock(mMutex);
+    while (true) {
+        while (!mStopping && mQueue.empty()) {
+            mCond.wait(lock);
+        }
+        if (mStopping) {
+            return;
+        }
+        const uint32_t buffer = mQueue.front();
+        mQueue.pop_front();
+        const std::string path = mSlots[buffer].path;
+        lock.unlock();
+        const long long result = readFile(path, mSlots[buffer].data, mBufferSize);
+        lock.lock();
+        mSlots[buffer].result = result;
+        mSlots[buffer].state = State::Done;
+        mCond.notify_all();
+    }
+}
+
+#endif
@@ -0,0 +1,82 @@
+#ifndef ASYNCFRAMEREADER_H
+#define ASYNCFRAMEREADER_H
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifdef SYNCTEST_USE_IO_URING
+#include <liburing.h>
+#endif
+
+// Reads whole files into a fixed set of aligned buffers in the background. Files are opened
+// for direct I/O (O_DIRECT, FILE_FLAG_NO_BUFFERING on Windows) where the file system allows
+// it, so the data goes from the device into the buffers without a page cache copy; buffers
+// are aligned and sized in whole blocks for that. Builds with SYNCTEST_USE_IO_URING queue the
+// reads on one io_uring, the others hand them to a pool of threads doing blocking reads.
+// Buffers are submitted and waited for by one thread at a time.
+class AsyncFrameReader
+{
+public:
+    // alignment of direct I/O buffers and transfer sizes
+    static constexpr size_t blockSize = 4096;
+
+    // bufferSize is rounded up to whole blocks, threads is ignored with io_uring
+    AsyncFrameReader(uint32_t buffers, size_t bufferSize, uint32_t threads);
+    ~AsyncFrameReader();
+
+    const char *backend() const;
+    uint8_t *data(uint32_t buffer) const { return mSlots[buffer].data; }
+
+    // queues reading the file at path into buffer, which must not have a read pending
+    void submit(uint32_t buffer, const std::string &path);
+    // submitted and not waited for yet
+    bool pending(uint32_t buffer) const;
+    // blocks until the read into buffer finished, returns the bytes read, exits on errors
+    size_t wait(uint32_t buffer);
+
+private:
+    enum class State {
+        Idle,
+        Queued,
+        Done,
+    };
+
+    struct Slot
+    {
+        uint8_t *data = nullptr;
+        std::string path;
+        State state = State::Idle;
+        // bytes read so far, or a negative error number
+        long long result = 0;
+#ifdef SYNCTEST_USE_IO_URING
+        int file = -1;
+#endif
+    };
+
+    std::vector<Slot> mSlots;
+    size_t mBufferSize = 0;
+
+    mutable std::mutex mMutex;
+    std::condition_variable mCond;
+#ifdef SYNCTEST_USE_IO_URING
+    void complete();
+    // reads the rest of the buffer from where its file has been read so far
+    void queueRead(uint32_t buffer);
+
+    io_uring mRing{};
+#else
+    void work();
+
+    std::deque<uint32_t> mQueue;
+    std::vector<std::thread> mThreads;
+    bool mStopping = false;
+#endif
+};
+
+#endif // ASYNCFRAMEREADER_H
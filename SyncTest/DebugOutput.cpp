@@ -0,0 +1,218 @@
+#include "DebugOutput.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+
+namespace {
+const std::chrono::milliseconds drainInterval(10);
+
+const char *sourceName(GLenum source)
+{
+    switch (source) {
+    case GL_DEBUG_SOURCE_API: return "api";
+    case GL_DEBUG_SOURCE_WINDOW_SYSTEM: return "window system";
+    case GL_DEBUG_SOURCE_SHADER_COMPILER: return "shader compiler";
+    case GL_DEBUG_SOURCE_THIRD_PARTY: return "third party";
+    case GL_DEBUG_SOURCE_APPLICATION: return "application";
+    default: return "other";
+    }
+}
+
+const char *typeName(GLenum type)
+{
+    switch (type) {
+    case GL_DEBUG_TYPE_ERROR: return "error";
+    case GL_DEBUG_TYPE_DEPRECATED_BEHAVIOR: return "deprecated";
+    case GL_DEBUG_TYPE_UNDEFINED_BEHAVIOR: return "undefined behavior";
+    case GL_DEBUG_TYPE_PORTABILITY: return "portability";
+    case GL_DEBUG_TYPE_PERFORMANCE: return "performance";
+    case GL_DEBUG_TYPE_MARKER: return "marker";
+    default: return "other";
+    }
+}
+
+const char *severityName(GLenum severity)
+{
+    switch (severity) {
+    case GL_DEBUG_SEVERITY_HIGH: return "high";
+    case GL_DEBUG_SEVERITY_MEDIUM: return "medium";
+    case GL_DEBUG_SEVERITY_LOW: return "low";
+    default: return "notification";
+    }
+}
+} // namespace
+
+DebugOutput::DebugOutput(Filter filter)
+    : mFilter(std::move(filter)), mCells(std::make_unique<Cell[]>(ringSize))
+{
+    for (size_t i = 0; i < ringSize; ++i) {
+        mCells[i].sequence.store(i, std::memory_order_relaxed);
+    }
+    mThread = std::thread([this]() {
+        while (!mFinished) {
+            drain();
+            std::this_thread::sleep_for(drainInterval);
+        }
+        drain();
+    });
+}
+
+DebugOutput::~DebugOutput()
+{
+    stop();
+}
+
+void DebugOutput::stop()
+{
+    mFinished = true;
+    if (mThread.joinable()) {
+        mThread.join();
+    }
+}
+
+bool DebugOutput::attach(const char *contextName)
+{
+    if (!GLAD_GL_VERSION_4_3) {
+        printf("GL debug output needs OpenGL 4.3\n");
+        return false;
+    }
+    GLint flags = 0;
+    glGetIntegerv(GL_CONTEXT_FLAGS, &flags);
+    if (!(flags & GL_CONTEXT_FLAG_DEBUG_BIT)) {
+        printf("Warning: %s context is not a debug context, messages may be missing\n",
+               contextName);
+    }
+
+    // contexts outlive the message callback registration, keep their user data here
+    auto context = std::make_unique<Context>();
+    context->output = this;
+    context->name = contextName;
+
+    // asynchronous: the driver does not serialize the calling thread for us
+    glEnable(GL_DEBUG_OUTPUT);
+    glDisable(GL_DEBUG_OUTPUT_SYNCHRONOUS);
+    glDebugMessageCallback(&DebugOutput::callback, context.get());
+
+    glDebugMessageControl(GL_DONT_CARE, GL_DONT_CARE, GL_DONT_CARE, 0, nullptr, GL_TRUE);
+    const GLenum severities[] = {GL_DEBUG_SEVERITY_NOTIFICATION, GL_DEBUG_SEVERITY_LOW,
+                                 GL_DEBUG_SEVERITY_MEDIUM, GL_DEBUG_SEVERITY_HIGH};
+    for (const GLenum severity : severities) {
+        if (severity == mFilter.minSeverity) {
+            break;
+        }
+        glDebugMessageControl(GL_DONT_CARE, GL_DONT_CARE, severity, 0, nullptr, GL_FALSE);
+    }
+    if (!mFilter.ignoredIds.empty()) {
+        // ids can only be filtered together with an explicit source and type
+        const GLenum sources[] = {GL_DEBUG_SOURCE_API, GL_DEBUG_SOURCE_WINDOW_SYSTEM,
+                                  GL_DEBUG_SOURCE_SHADER_COMPILER, GL_DEBUG_SOURCE_THIRD_PARTY,
+                                  GL_DEBUG_SOURCE_APPLICATION, GL_DEBUG_SOURCE_OTHER};
+        const GLenum types[] = {GL_DEBUG_TYPE_ERROR, GL_DEBUG_TYPE_DEPRECATED_BEHAVIOR,
+                                GL_DEBUG_TYPE_UNDEFINED_BEHAVIOR, GL_DEBUG_TYPE_PORTABILITY,
+                                GL_DEBUG_TYPE_PERFORMANCE, GL_DEBUG_TYPE_MARKER,
+                                GL_DEBUG_TYPE_OTHER};
+        for (const GLenum source : sources) {
+            for (const GLenum type : types) {
+                glDebugMessageControl(source, type, GL_DONT_CARE,
+                                      static_cast<GLsizei>(mFilter.ignoredIds.size()),
+                                      mFilter.ignoredIds.data(), GL_FALSE);
+            }
+        }
+    }
+
+    mContexts.push_back(std::move(context));
+    return true;
+}
+
+void GLAD_API_PTR DebugOutput::callback(GLenum source, GLenum type, GLuint id, GLenum severity,
+                                        GLsizei length, const GLchar *message,
+                                        const void *userParam)
+{
+    const auto *context = static_cast<const Context *>(userParam);
+    DebugOutput *output = context->output;
+
+    output->mMessages.fetch_add(1, std::memory_order_relaxed);
+    if (type == GL_DEBUG_TYPE_ERROR) {
+        output->mErrors.fetch_add(1, std::memory_order_relaxed);
+    } else if (type == GL_DEBUG_TYPE_PERFORMANCE) {
+        output->mPerformance.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    Message entry;
+    entry.context = context->name;
+    entry.source = source;
+    entry.type = type;
+    entry.severity = severity;
+    entry.id = id;
+    const size_t textLength = std::min(length >= 0 ? static_cast<size_t>(length)
+                                                   : strlen(message),
+                                       sizeof(entry.text) - 1);
+    memcpy(entry.text, message, textLength);
+    entry.text[textLength] = 0;
+
+    if (!output->push(entry)) {
+        output->mDropped.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+bool DebugOutput::push(const Message &message)
+{
+    size_t pos = mEnqueuePos.load(std::memory_order_relaxed);
+    Cell *cell;
+    while (true) {
+        cell = &mCells[pos % ringSize];
+        const size_t sequence = cell->sequence.load(std::memory_order_acquire);
+        const auto diff = static_cast<std::ptrdiff_t>(sequence) - static_cast<std::ptrdiff_t>(pos);
+        if (diff == 0) {
+            if (mEnqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                break;
+            }
+        } else if (diff < 0) {
+            // full, never block the driver
+            return false;
+        } else {
+            pos = mEnqueuePos.load(std::memory_order_relaxed);
+        }
+    }
+    cell->message = message;
+    cell->sequence.store(pos + 1, std::memory_order_release);
+    return true;
+}
+
+bool DebugOutput::pop(Message &message)
+{
+    Cell &cell = mCells[mDequeuePos % ringSize];
+    if (cell.sequence.load(std::memory_order_acquire) != mDequeuePos + 1) {
+        return false;
+    }
+    message = cell.message;
+    cell.sequence.store(mDequeuePos + ringSize, std::memory_order_release);
+    mDequeuePos++;
+    return true;
+}
+
+void DebugOutput::drain()
+{
+    Message message;
+    while (pop(message)) {
+        print(message);
+    }
+}
+
+void DebugOutput::print(const Message &message) const
+{
+    printf("GL %s [%s, %s, %s, id %u]: %s\n", message.context, typeName(message.type),
+           severityName(message.severity), sourceName(message.source), message.id,
+           message.text);
+}
+
+void DebugOutput::printStats() const
+{
+    printf("GL debug output: %llu messages, %llu errors, %llu performance, %llu dropped\n",
+           static_cast<unsigned long long>(mMessages.load()),
+           static_cast<unsigned long long>(mErrors.load()),
+           static_cast<unsigned long long>(mPerformance.load()),
+           static_cast<unsigned long long>(mDropped.load()));
+}
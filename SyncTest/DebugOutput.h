@@ -0,0 +1,97 @@
+#ifndef DEBUGOUTPUT_H
+#define DEBUGOUTPUT_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "glad/gl.h"
+
+// GL debug output without per-frame glGetError. The driver callback only copies the message
+// into a lock-free ring, a background thread drains and prints it. Needs debug contexts
+// (SDL_GL_CONTEXT_DEBUG_FLAG) and OpenGL 4.3; attach() is called on every context.
+class DebugOutput
+{
+public:
+    struct Filter
+    {
+        // messages below this severity are disabled with glDebugMessageControl
+        GLenum minSeverity = GL_DEBUG_SEVERITY_NOTIFICATION;
+        // message ids disabled for every source and type
+        std::vector<GLuint> ignoredIds;
+    };
+
+    explicit DebugOutput(Filter filter);
+    ~DebugOutput();
+
+    DebugOutput(const DebugOutput &) = delete;
+    DebugOutput &operator=(const DebugOutput &) = delete;
+
+    // enables asynchronous debug output on the current context, name shows up in messages;
+    // called before other threads start using the contexts
+    bool attach(const char *contextName);
+    // drains and prints the remaining messages and stops the drain thread
+    void stop();
+
+    // GL_DEBUG_TYPE_ERROR messages seen so far, cheap to poll every frame
+    uint64_t errors() const { return mErrors.load(std::memory_order_relaxed); }
+
+    void printStats() const;
+
+private:
+    struct Message
+    {
+        const char *context = nullptr;
+        GLenum source = 0;
+        GLenum type = 0;
+        GLenum severity = 0;
+        GLuint id = 0;
+        // truncated, driver messages are rarely longer
+        char text[256] = {};
+    };
+
+    struct Cell
+    {
+        std::atomic<size_t> sequence;
+        Message message;
+    };
+
+    struct Context
+    {
+        DebugOutput *output = nullptr;
+        const char *name = nullptr;
+    };
+
+    static void GLAD_API_PTR callback(GLenum source, GLenum type, GLuint id, GLenum severity,
+                                      GLsizei length, const GLchar *message,
+                                      const void *userParam);
+
+    // multiple producers: the driver may call back from any of its threads
+    bool push(const Message &message);
+    // single consumer: the drain thread
+    bool pop(Message &message);
+    void drain();
+    void print(const Message &message) const;
+
+    Filter mFilter;
+
+    static constexpr size_t ringSize = 1024;
+    std::unique_ptr<Cell[]> mCells;
+    std::atomic<size_t> mEnqueuePos = 0;
+    size_t mDequeuePos = 0;
+
+    std::vector<std::unique_ptr<Context>> mContexts;
+
+    std::atomic_bool mFinished = false;
+    std::thread mThread;
+
+    std::atomic<uint64_t> mMessages = 0;
+    std::atomic<uint64_t> mErrors = 0;
+    std::atomic<uint64_t> mPerformance = 0;
+    std::atomic<uint64_t> mDropped = 0;
+};
+
+#endif // DEBUGOUTPUT_H
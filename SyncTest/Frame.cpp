@@ -0,0 +1,94 @@
+#include "Frame.h"
+
+#include <cstring>
+#include <vector>
+
+#include "MaskPack.h"
+
+namespace {
+// lit HDR bars are brighter than SDR white, which RGBA8 could not carry
+const float hdrBarValue = 4.0f;
+
+bool barLit(uint32_t x, uint32_t offset)
+{
+    return (x + offset) / barWidth % 2 == 0;
+}
+
+uint8_t barValue(uint32_t x, uint32_t offset)
+{
+    return barLit(x, offset) ? 255 : 0;
+}
+
+// one row of bars as v210 words: video range luma, neutral chroma
+void generateV210Row(const FrameFormat &format, uint8_t *row, uint32_t offset)
+{
+    const uint32_t black = 64;
+    const uint32_t white = 940;
+    const uint32_t chroma = 512;
+    auto luma = [&](uint32_t x) { return x < format.width && barLit(x, offset) ? white : black; };
+    auto pack = [](uint32_t a, uint32_t b, uint32_t c) { return a | b << 10 | c << 20; };
+
+    std::memset(row, 0, format.rowBytes());
+    for (uint32_t x = 0; x < format.width; x += 6) {
+        // Cb0 Y0 Cr0 | Y1 Cb2 Y2 | Cr2 Y3 Cb4 | Y4 Cr4 Y5
+        const uint32_t words[4] = {pack(chroma, luma(x), chroma),
+                                   pack(luma(x + 1), chroma, luma(x + 2)),
+                                   pack(chroma, luma(x + 3), chroma),
+                                   pack(luma(x + 4), chroma, luma(x + 5))};
+        std::memcpy(row + x / 6 * sizeof(words), words, sizeof(words));
+    }
+}
+} // namespace
+
+void generateBars(const FrameFormat &format, uint8_t *data, size_t pitch, uint32_t offset)
+{
+    if (format.pixelFormat == PixelFormat::Mask1) {
+        // the bars are two-level, a grayscale row thresholds into bits without loss
+        std::vector<uint8_t> row(format.width);
+        for (uint32_t x = 0; x < format.width; ++x) {
+            row[x] = barValue(x, offset);
+        }
+        packMask(row.data(), data, row.size());
+    } else if (format.pixelFormat == PixelFormat::V210) {
+        generateV210Row(format, data, offset);
+    } else if (format.pixelFormat == PixelFormat::RGBA16F) {
+        for (uint32_t x = 0; x < format.width; ++x) {
+            const float value = barLit(x, offset) ? hdrBarValue : 0.0f;
+            const float texel[4] = {value, value, value, 1.0f};
+            std::memcpy(data + x * sizeof(texel), texel, sizeof(texel));
+        }
+    } else {
+        const uint32_t texelBytes = format.texelBytes();
+        for (uint32_t x = 0; x < format.width; ++x) {
+            const uint8_t value = barValue(x, offset);
+            for (uint32_t i = 0; i < texelBytes; ++i) {
+                data[x * texelBytes + i] = value;
+            }
+        }
+    }
+    // vertical bars: every row is the same
+    for (uint32_t y = 1; y < format.height; ++y) {
+        std::memcpy(data + y * pitch, data, format.sourceRowBytes());
+    }
+    // gray bars have neutral chroma
+    for (uint32_t y = format.height; y < format.uploadHeight(); ++y) {
+        std::memset(data + y * pitch, 128, format.sourceRowBytes());
+    }
+}
+
+uint32_t streamBarsOffset(uint32_t offset, uint32_t stream, uint32_t streams)
+{
+    return (offset + stream * barPeriod / streams) % barPeriod;
+}
+
+void copyRows(uint8_t *dst, size_t dstPitch, const uint8_t *src, size_t srcPitch,
+              size_t rowBytes, size_t rows)
+{
+    if (dstPitch == rowBytes && srcPitch == rowBytes) {
+        std::memcpy(dst, src, rowBytes * rows);
+        return;
+    }
+    for (size_t row = 0; row < rows; ++row) {
+        std::memcpy(dst + row * dstPitch, src + row * srcPitch, rowBytes);
+    }
+}
@@ -0,0 +1,30 @@
+#ifndef FRAME_H
+#define FRAME_H
+
+#include <cstddef>
+#include <cstdint>
+
+#include "PixelFormat.h"
+
+const uint32_t texturesCount = 4;
+const uint32_t texWidth = 1920;
+const uint32_t texHeight = 1080;
+
+const uint32_t barsCount = 8;
+const uint32_t barPeriod = texWidth / barsCount;
+const uint32_t barWidth = barPeriod / 2;
+const uint32_t barMoveStep = 4;
+// the bars would fit one bit per pixel, but full RGBA8 frames are the upload load the repro
+// needs; --upload-format mask1 or r8 opts into the lighter formats
+const PixelFormat barsFormat = PixelFormat::RGBA8;
+
+// rows of format.sourceRowBytes() bytes, pitch bytes apart
+void generateBars(const FrameFormat &format, uint8_t *data, size_t pitch, uint32_t offset);
+// bars of every stream are shifted so the streams are distinguishable on screen
+uint32_t streamBarsOffset(uint32_t offset, uint32_t stream, uint32_t streams);
+
+// copies rows between buffers with different row pitches
+void copyRows(uint8_t *dst, size_t dstPitch, const uint8_t *src, size_t srcPitch,
+              size_t rowBytes, size_t rows);
+
+#endif // FRAME_H
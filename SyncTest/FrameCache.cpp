@@ -0,0 +1,169 @@
+#include "FrameCache.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <utility>
+
+#include "Frame.h"
+
+const uint8_t *FrameCache::find(uint32_t clip, uint64_t frame)
+{
+    const auto found = mIndex.find({clip, frame});
+    if (found == mIndex.end()) {
+        mStats.misses++;
+        return nullptr;
+    }
+    mStats.hits++;
+    mEntries.splice(mEntries.begin(), mEntries, found->second);
+    return found->second->data.get();
+}
+
+uint8_t *FrameCache::insert(uint32_t clip, uint64_t frame, size_t size)
+{
+    std::unique_ptr<uint8_t[]> reuse;
+    if (size > mBudget || !makeRoom(size, reuse)) {
+        return nullptr;
+    }
+
+    Entry entry;
+    entry.key = {clip, frame};
+    // frames of a clip share one size, the memory of an evicted one is taken over as it is
+    entry.data = reuse ? std::move(reuse) : std::unique_ptr<uint8_t[]>(new uint8_t[size]);
+    entry.size = size;
+    mEntries.push_front(std::move(entry));
+    mIndex[mEntries.front().key] = mEntries.begin();
+    mStats.frames++;
+    mStats.bytes += size;
+    mStats.peakBytes = std::max(mStats.peakBytes, mStats.bytes);
+    return mEntries.front().data.get();
+}
+
+void FrameCache::pin(uint32_t clip, uint64_t frame)
+{
+    const auto found = mIndex.find({clip, frame});
+    if (found != mIndex.end()) {
+        found->second->pins++;
+    }
+}
+
+void FrameCache::unpin(uint32_t clip, uint64_t frame)
+{
+    const auto found = mIndex.find({clip, frame});
+    if (found != mIndex.end() && found->second->pins) {
+        found->second->pins--;
+    }
+}
+
+void FrameCache::printStats() const
+{
+    const uint64_t lookups = mStats.hits + mStats.misses;
+    printf("Frame cache: %.1f%% hits (%llu of %llu), %llu frames in %.1f of %.1f MB, "
+           "peak %.1f MB, %llu evictions\n",
+           lookups ? 100.0 * mStats.hits / lookups : 0.0,
+           static_cast<unsigned long long>(mStats.hits),
+           static_cast<unsigned long long>(lookups),
+           static_cast<unsigned long long>(mStats.frames), mStats.bytes / 1e6, mBudget / 1e6,
+           mStats.peakBytes / 1e6, static_cast<unsigned long long>(mStats.evictions));
+}
+
+bool FrameCache::makeRoom(size_t size, std::unique_ptr<uint8_t[]> &reuse)
+{
+    auto it = mEntries.end();
+    while (mStats.bytes + size > mBudget) {
+        if (it == mEntries.begin()) {
+            return false;
+        }
+        --it;
+        if (it->pins) {
+            continue;
+        }
+        if (it->size == size) {
+            reuse = std::move(it->data);
+        }
+        mStats.frames--;
+        mStats.bytes -= it->size;
+        mStats.evictions++;
+        mIndex.erase(it->key);
+        // the next step goes on with the entry in front of the erased one
+        it = mEntries.erase(it);
+    }
+    return true;
+}
+
+CachedSource::CachedSource(std::unique_ptr<FrameSource> source, FrameCache &cache,
+                           uint32_t streams)
+    : mSource(std::move(source)), mCache(cache), mClip(cache.addClip()), mPins(streams),
+      mUncached(streams)
+{}
+
+CachedSource::~CachedSource()
+{
+    // the cache may outlive the source, its frames must not stay pinned
+    for (const Pin &pin : mPins) {
+        if (pin.pinned) {
+            mCache.unpin(mClip, pin.frame);
+        }
+    }
+}
+
+const uint8_t *CachedSource::frameData(uint32_t stream, uint64_t frame)
+{
+    uint64_t index = 0;
+    if (!mSource->clipFrame(stream, frame, index)) {
+        return mSource->frameData(stream, frame);
+    }
+
+    Pin &pin = mPins[stream];
+    const uint8_t *data = mCache.find(mClip, index);
+    if (!data) {
+        const FrameFormat &frameFormat = format();
+        uint8_t *fill = mCache.insert(mClip, index, frameFormat.sourceFrameBytes());
+        const bool cached = fill;
+        if (!cached) {
+            if (!mUncached[stream]) {
+                mUncached[stream].reset(new uint8_t[frameFormat.sourceFrameBytes()]);
+            }
+            fill = mUncached[stream].get();
+        }
+        if (const uint8_t *produced = mSource->frameData(stream, frame)) {
+            std::memcpy(fill, produced, frameFormat.sourceFrameBytes());
+        } else {
+            mSource->readFrame(stream, frame, fill, frameFormat.sourceRowBytes());
+        }
+        data = fill;
+        if (!cached) {
+            if (pin.pinned) {
+                mCache.unpin(mClip, pin.frame);
+            }
+            pin.pinned = false;
+            return data;
+        }
+    }
+
+    // pinned before the previous frame is released, both may be the same
+    mCache.pin(mClip, index);
+    if (pin.pinned) {
+        mCache.unpin(mClip, pin.frame);
+    }
+    pin.pinned = true;
+    pin.frame = index;
+    return data;
+}
+
+void CachedSource::readFrame(uint32_t stream, uint64_t frame, uint8_t *dst, size_t pitch)
+{
+    const size_t rowBytes = format().sourceRowBytes();
+    const uint8_t *data = frameData(stream, frame);
+    if (!data) {
+        mSource->readFrame(stream, frame, dst, pitch);
+        return;
+    }
+    copyRows(dst, pitch, data, rowBytes, rowBytes, format().uploadHeight());
+}
+
+void CachedSource::printStats() const
+{
+    mCache.printStats();
+    mSource->printStats();
+}
@@ -0,0 +1,124 @@
+#ifndef FRAMECACHE_H
+#define FRAMECACHE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <list>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+#include "FrameSource.h"
+
+// Frames of looped clips kept in RAM, keyed by clip and frame of the clip, least recently used
+// frames evicted first once the budget is exceeded. Frames handed out are pinned and not
+// evicted until their user moves on. Used from one thread at a time.
+class FrameCache
+{
+public:
+    struct Stats
+    {
+        uint64_t hits = 0;
+        uint64_t misses = 0;
+        uint64_t evictions = 0;
+        uint64_t frames = 0;
+        uint64_t bytes = 0;
+        uint64_t peakBytes = 0;
+    };
+
+    explicit FrameCache(uint64_t budgetBytes) : mBudget(budgetBytes) {}
+
+    // key space of a new clip
+    uint32_t addClip() { return mClips++; }
+
+    // cached frame, null on a miss; counts the lookup
+    const uint8_t *find(uint32_t clip, uint64_t frame);
+    // memory of size for a frame missing from the cache, to be filled by the caller; null
+    // when the budget cannot make room because the other frames are pinned
+    uint8_t *insert(uint32_t clip, uint64_t frame, size_t size);
+    // pinned frames are never evicted, every pin needs an unpin
+    void pin(uint32_t clip, uint64_t frame);
+    void unpin(uint32_t clip, uint64_t frame);
+
+    uint64_t budget() const { return mBudget; }
+    const Stats &stats() const { return mStats; }
+    void printStats() const;
+
+private:
+    struct Key
+    {
+        uint32_t clip = 0;
+        uint64_t frame = 0;
+
+        bool operator==(const Key &other) const
+        {
+            return clip == other.clip && frame == other.frame;
+        }
+    };
+
+    struct KeyHash
+    {
+        size_t operator()(const Key &key) const
+        {
+            return std::hash<uint64_t>()(key.frame * 0x9e3779b97f4a7c15ull + key.clip);
+        }
+    };
+
+    struct Entry
+    {
+        Key key;
+        std::unique_ptr<uint8_t[]> data;
+        size_t size = 0;
+        uint32_t pins = 0;
+    };
+
+    // evicts unpinned frames from the back until size fits, false if it cannot
+    bool makeRoom(size_t size, std::unique_ptr<uint8_t[]> &reuse);
+
+    const uint64_t mBudget = 0;
+    uint32_t mClips = 0;
+    // most recently used first
+    std::list<Entry> mEntries;
+    std::unordered_map<Key, std::list<Entry>::iterator, KeyHash> mIndex;
+    Stats mStats;
+};
+
+// Puts a FrameCache in front of a source: frames the source repeats are produced once and
+// then handed to staging from the cache, so a hit is one copy into the upload arena. Frames
+// of sources that do not repeat them pass through.
+class CachedSource : public FrameSource
+{
+public:
+    CachedSource(std::unique_ptr<FrameSource> source, FrameCache &cache, uint32_t streams);
+    ~CachedSource() override;
+
+    const char *name() const override { return mSource->name(); }
+    const FrameFormat &format() const override { return mSource->format(); }
+    bool clipFrame(uint32_t stream, uint64_t frame, uint64_t &index) const override
+    {
+        return mSource->clipFrame(stream, frame, index);
+    }
+
+    const uint8_t *frameData(uint32_t stream, uint64_t frame) override;
+    void readFrame(uint32_t stream, uint64_t frame, uint8_t *dst, size_t pitch) override;
+
+    void printStats() const override;
+
+private:
+    struct Pin
+    {
+        bool pinned = false;
+        uint64_t frame = 0;
+    };
+
+    const std::unique_ptr<FrameSource> mSource;
+    FrameCache &mCache;
+    const uint32_t mClip = 0;
+    // the frame last handed out per stream stays valid until the next one of the stream
+    std::vector<Pin> mPins;
+    // frames that found no room in the cache
+    std::vector<std::unique_ptr<uint8_t[]>> mUncached;
+};
+
+#endif // FRAMECACHE_H
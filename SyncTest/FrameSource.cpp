@@ -0,0 +1,22 @@
+#include "FrameSource.h"
+
+#include "Frame.h"
+
+BarsSource::BarsSource(const FrameFormat &format, uint32_t streams)
+    : mFormat(format), mStreams(streams)
+{}
+
+bool BarsSource::clipFrame(uint32_t stream, uint64_t frame, uint64_t &index) const
+{
+    // the first frame is already one step in
+    const uint32_t offset = static_cast<uint32_t>((frame + 1) * barMoveStep % barPeriod);
+    index = streamBarsOffset(offset, stream, mStreams);
+    return true;
+}
+
+void BarsSource::readFrame(uint32_t stream, uint64_t frame, uint8_t *dst, size_t pitch)
+{
+    uint64_t offset = 0;
+    clipFrame(stream, frame, offset);
+    generateBars(mFormat, dst, pitch, static_cast<uint32_t>(offset));
+}
@@ -0,0 +1,52 @@
+#ifndef FRAMESOURCE_H
+#define FRAMESOURCE_H
+
+#include <cstddef>
+#include <cstdint>
+
+#include "PixelFormat.h"
+
+// Content of the streams. Frames are numbered from 0 per stream and laid out as the producer
+// writes them, format().sourceRowBytes() per row; staging converts them to the uploaded format.
+// Called from the producer thread of one pipeline at a time and from UploadPipeline::prepare().
+class FrameSource
+{
+public:
+    virtual ~FrameSource() = default;
+
+    virtual const char *name() const = 0;
+    virtual const FrameFormat &format() const = 0;
+    // frame of the looped content that stream shows as frame, equal indices are equal
+    // pictures; false for sources that do not repeat frames
+    virtual bool clipFrame(uint32_t /*stream*/, uint64_t /*frame*/, uint64_t & /*index*/) const
+    {
+        return false;
+    }
+
+    // frame already in memory, rows packed, valid until the next frame of the same stream is
+    // requested; null when it has to be produced with readFrame()
+    virtual const uint8_t *frameData(uint32_t /*stream*/, uint64_t /*frame*/) { return nullptr; }
+    // writes the frame into dst with rows pitch bytes apart
+    virtual void readFrame(uint32_t stream, uint64_t frame, uint8_t *dst, size_t pitch) = 0;
+
+    virtual void printStats() const {}
+};
+
+// moving black and white bars, generated for every frame
+class BarsSource : public FrameSource
+{
+public:
+    BarsSource(const FrameFormat &format, uint32_t streams);
+
+    const char *name() const override { return "bars"; }
+    const FrameFormat &format() const override { return mFormat; }
+    // the bars repeat once they moved by one period
+    bool clipFrame(uint32_t stream, uint64_t frame, uint64_t &index) const override;
+    void readFrame(uint32_t stream, uint64_t frame, uint8_t *dst, size_t pitch) override;
+
+private:
+    const FrameFormat mFormat;
+    const uint32_t mStreams = 1;
+};
+
+#endif // FRAMESOURCE_H
@@ -0,0 +1,345 @@
+#include "GlState.h"
+
+#include <cstdio>
+#include <cstdlib>
+
+namespace {
+// integer textures are incomplete with linear filtering, texelFetch would read zero
+bool isIntegerFormat(GLenum internalFormat)
+{
+    switch (internalFormat) {
+    case GL_R32UI:
+    case GL_RGBA32UI: return true;
+    default: return false;
+    }
+}
+} // namespace
+
+GlState::GlState()
+{
+    mDsa = GLAD_GL_VERSION_4_5 != 0;
+    mTextureStorage = GLAD_GL_VERSION_4_2 != 0;
+    mBufferStorage = GLAD_GL_VERSION_4_4 != 0;
+    invalidate();
+}
+
+void GlState::invalidate()
+{
+    mBuffers.fill(unknown);
+    mVertexArray = unknown;
+    mProgram = unknown;
+    mActiveUnit = unknown;
+    mTextures.fill(unknown);
+    mTextureArrays.fill(unknown);
+    mUnpackAlignment = -1;
+    mUnpackRowLength = -1;
+    mFramebuffer = unknown;
+}
+
+int GlState::bufferIndex(GLenum target)
+{
+    switch (target) {
+    case GL_ARRAY_BUFFER: return 0;
+    case GL_PIXEL_UNPACK_BUFFER: return 1;
+    case GL_PIXEL_PACK_BUFFER: return 2;
+    case GL_COPY_WRITE_BUFFER: return 3;
+    default: return -1;
+    }
+}
+
+bool GlState::changed(GLuint &cached, GLuint value)
+{
+    if (cached == value) {
+        mSkipped.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+    cached = value;
+    count();
+    return true;
+}
+
+void GlState::bindBuffer(GLenum target, GLuint buffer)
+{
+    const int index = bufferIndex(target);
+    if (index < 0) {
+        count();
+        glBindBuffer(target, buffer);
+    } else if (changed(mBuffers[index], buffer)) {
+        glBindBuffer(target, buffer);
+    }
+}
+
+void GlState::bindVertexArray(GLuint vertexArray)
+{
+    if (changed(mVertexArray, vertexArray)) {
+        glBindVertexArray(vertexArray);
+    }
+}
+
+void GlState::useProgram(GLuint program)
+{
+    if (changed(mProgram, program)) {
+        glUseProgram(program);
+    }
+}
+
+void GlState::activeTexture(GLuint unit)
+{
+    if (changed(mActiveUnit, unit)) {
+        glActiveTexture(GL_TEXTURE0 + unit);
+    }
+}
+
+void GlState::bindTexture(GLuint unit, GLuint texture, GLenum target)
+{
+    if (unit >= textureUnits) {
+        printf("Texture unit %u is not tracked\n", unit);
+        exit(1);
+    }
+    // every target has its own binding on a unit
+    auto &cached = target == GL_TEXTURE_2D_ARRAY ? mTextureArrays : mTextures;
+    if (!changed(cached[unit], texture)) {
+        return;
+    }
+    if (mDsa) {
+        glBindTextureUnit(unit, texture);
+        // binding zero this way unbinds every target of the unit
+        if (texture == 0) {
+            mTextures[unit] = 0;
+            mTextureArrays[unit] = 0;
+        }
+    } else {
+        activeTexture(unit);
+        glBindTexture(target, texture);
+    }
+}
+
+void GlState::pixelStore(GLenum name, GLint value)
+{
+    GLint *cached = name == GL_UNPACK_ALIGNMENT    ? &mUnpackAlignment
+                    : name == GL_UNPACK_ROW_LENGTH ? &mUnpackRowLength
+                                                   : nullptr;
+    if (cached && *cached == value) {
+        mSkipped.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    if (cached) {
+        *cached = value;
+    }
+    count();
+    glPixelStorei(name, value);
+}
+
+void GlState::bindFramebuffer(GLuint framebuffer)
+{
+    if (changed(mFramebuffer, framebuffer)) {
+        glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+    }
+}
+
+void GlState::textureSwizzle(GLuint texture, const GLint swizzle[4], GLenum target)
+{
+    count();
+    if (mDsa) {
+        glTextureParameteriv(texture, GL_TEXTURE_SWIZZLE_RGBA, swizzle);
+        return;
+    }
+    bindTexture(mActiveUnit < textureUnits ? mActiveUnit : 0, texture, target);
+    glTexParameteriv(target, GL_TEXTURE_SWIZZLE_RGBA, swizzle);
+}
+
+GLuint GlState::genTexture(GLenum target, GLenum internalFormat)
+{
+    GLuint texture = 0;
+    if (mDsa) {
+        glCreateTextures(target, 1, &texture);
+    } else {
+        glGenTextures(1, &texture);
+    }
+    if (!texture) {
+        printf("glGenTextures failed\n");
+        exit(1);
+    }
+    const GLint filter = isIntegerFormat(internalFormat) ? GL_NEAREST : GL_LINEAR;
+    if (mDsa) {
+        glTextureParameteri(texture, GL_TEXTURE_MIN_FILTER, filter);
+        glTextureParameteri(texture, GL_TEXTURE_MAG_FILTER, filter);
+        glTextureParameteri(texture, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTextureParameteri(texture, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    } else {
+        bindTexture(mActiveUnit < textureUnits ? mActiveUnit : 0, texture, target);
+        glTexParameteri(target, GL_TEXTURE_MIN_FILTER, filter);
+        glTexParameteri(target, GL_TEXTURE_MAG_FILTER, filter);
+        glTexParameteri(target, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(target, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    }
+    return texture;
+}
+
+GLuint GlState::createTexture(GLenum internalFormat, GLsizei width, GLsizei height)
+{
+    const GLuint texture = genTexture(GL_TEXTURE_2D, internalFormat);
+    if (mDsa) {
+        glTextureStorage2D(texture, 1, internalFormat, width, height);
+    } else if (mTextureStorage) {
+        glTexStorage2D(GL_TEXTURE_2D, 1, internalFormat, width, height);
+    } else {
+        // only the internal format matters without a pixel source
+        glTexImage2D(GL_TEXTURE_2D, 0, internalFormat, width, height, 0,
+                     isIntegerFormat(internalFormat) ? GL_RGBA_INTEGER : GL_RGBA,
+                     GL_UNSIGNED_BYTE, nullptr);
+    }
+    return texture;
+}
+
+GLuint GlState::createTextureArray(GLenum internalFormat, GLsizei width, GLsizei height,
+                                   GLsizei layers)
+{
+    const GLuint texture = genTexture(GL_TEXTURE_2D_ARRAY, internalFormat);
+    if (mDsa) {
+        glTextureStorage3D(texture, 1, internalFormat, width, height, layers);
+    } else if (mTextureStorage) {
+        glTexStorage3D(GL_TEXTURE_2D_ARRAY, 1, internalFormat, width, height, layers);
+    } else {
+        glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, internalFormat, width, height, layers, 0,
+                     isIntegerFormat(internalFormat) ? GL_RGBA_INTEGER : GL_RGBA,
+                     GL_UNSIGNED_BYTE, nullptr);
+    }
+    return texture;
+}
+
+GLuint GlState::createBuffer(GLenum target, GLsizeiptr size, const void *data, GLbitfield flags)
+{
+    GLuint buffer = 0;
+    if (mDsa) {
+        glCreateBuffers(1, &buffer);
+    } else {
+        glGenBuffers(1, &buffer);
+    }
+    if (!buffer) {
+        printf("glGenBuffers failed\n");
+        exit(1);
+    }
+    if (mDsa) {
+        glNamedBufferStorage(buffer, size, data, flags);
+    } else {
+        bindBuffer(target, buffer);
+        if (mBufferStorage) {
+            glBufferStorage(target, size, data, flags);
+        } else {
+            glBufferData(target, size, data, GL_STREAM_DRAW);
+        }
+    }
+    return buffer;
+}
+
+GLuint GlState::createFramebuffer(GLuint colorTexture)
+{
+    GLuint framebuffer = 0;
+    GLenum status = 0;
+    if (mDsa) {
+        glCreateFramebuffers(1, &framebuffer);
+        glNamedFramebufferTexture(framebuffer, GL_COLOR_ATTACHMENT0, colorTexture, 0);
+        status = glCheckNamedFramebufferStatus(framebuffer, GL_FRAMEBUFFER);
+    } else {
+        glGenFramebuffers(1, &framebuffer);
+        bindFramebuffer(framebuffer);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, colorTexture,
+                               0);
+        status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+    }
+    if (status != GL_FRAMEBUFFER_COMPLETE) {
+        printf("Framebuffer incomplete: 0x%04x\n", status);
+        exit(1);
+    }
+    return framebuffer;
+}
+
+void GlState::deleteTexture(GLuint texture)
+{
+    // GL unbinds deleted objects from the current context, the cache has to follow
+    for (auto *textures : {&mTextures, &mTextureArrays}) {
+        for (auto &cached : *textures) {
+            if (cached == texture) {
+                cached = 0;
+            }
+        }
+    }
+    glDeleteTextures(1, &texture);
+}
+
+void GlState::deleteBuffer(GLuint buffer)
+{
+    for (auto &cached : mBuffers) {
+        if (cached == buffer) {
+            cached = 0;
+        }
+    }
+    glDeleteBuffers(1, &buffer);
+}
+
+void GlState::deleteFramebuffer(GLuint framebuffer)
+{
+    if (mFramebuffer == framebuffer) {
+        mFramebuffer = 0;
+    }
+    glDeleteFramebuffers(1, &framebuffer);
+}
+
+void GlState::bufferSubData(GLenum target, GLuint buffer, GLintptr offset, GLsizeiptr size,
+                            const void *data)
+{
+    count();
+    if (mDsa) {
+        glNamedBufferSubData(buffer, offset, size, data);
+        return;
+    }
+    bindBuffer(target, buffer);
+    glBufferSubData(target, offset, size, data);
+}
+
+void *GlState::mapBuffer(GLenum target, GLuint buffer, GLintptr offset, GLsizeiptr length,
+                         GLbitfield access)
+{
+    count();
+    if (mDsa) {
+        return glMapNamedBufferRange(buffer, offset, length, access);
+    }
+    bindBuffer(target, buffer);
+    return glMapBufferRange(target, offset, length, access);
+}
+
+void GlState::unmapBuffer(GLenum target, GLuint buffer)
+{
+    count();
+    if (mDsa) {
+        glUnmapNamedBuffer(buffer);
+        return;
+    }
+    bindBuffer(target, buffer);
+    glUnmapBuffer(target);
+}
+
+void GlState::texSubImage2D(GLuint texture, GLsizei width, GLsizei height, GLenum format,
+                            GLenum type, const void *pixels)
+{
+    count();
+    if (mDsa) {
+        glTextureSubImage2D(texture, 0, 0, 0, width, height, format, type, pixels);
+        return;
+    }
+    bindTexture(mActiveUnit < textureUnits ? mActiveUnit : 0, texture);
+    glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, width, height, format, type, pixels);
+}
+
+void GlState::texSubImage3D(GLuint texture, GLint layer, GLsizei width, GLsizei height,
+                            GLenum format, GLenum type, const void *pixels)
+{
+    count();
+    if (mDsa) {
+        glTextureSubImage3D(texture, 0, 0, 0, layer, width, height, 1, format, type, pixels);
+        return;
+    }
+    bindTexture(mActiveUnit < textureUnits ? mActiveUnit : 0, texture, GL_TEXTURE_2D_ARRAY);
+    glTexSubImage3D(GL_TEXTURE_2D_ARRAY, 0, 0, 0, layer, width, height, 1, format, type, pixels);
+}
@@ -0,0 +1,93 @@
+#ifndef GLSTATE_H
+#define GLSTATE_H
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+
+#include "glad/gl.h"
+
+// Binding cache of one context that skips redundant binds, and a thin layer over GL 4.5
+// direct state access with bind-to-edit fallbacks for older contexts. Everything issuing GL
+// calls on the context goes through its GlState, otherwise the cache goes stale; deleting
+// objects through it drops them from the cache. Used by one thread at a time.
+class GlState
+{
+public:
+    GlState();
+
+    bool directStateAccess() const { return mDsa; }
+    // forget everything, the next bind of every kind is issued
+    void invalidate();
+
+    void bindBuffer(GLenum target, GLuint buffer);
+    void bindVertexArray(GLuint vertexArray);
+    void useProgram(GLuint program);
+    // GL_TEXTURE_2D or GL_TEXTURE_2D_ARRAY binding of a texture unit
+    void bindTexture(GLuint unit, GLuint texture, GLenum target = GL_TEXTURE_2D);
+    void pixelStore(GLenum name, GLint value);
+    // GL_FRAMEBUFFER, draw and read
+    void bindFramebuffer(GLuint framebuffer);
+
+    void textureSwizzle(GLuint texture, const GLint swizzle[4], GLenum target = GL_TEXTURE_2D);
+    // linear filtered, edge clamped 2D texture with one level, immutable when available
+    GLuint createTexture(GLenum internalFormat, GLsizei width, GLsizei height);
+    // the same as a 2D array texture of layers
+    GLuint createTextureArray(GLenum internalFormat, GLsizei width, GLsizei height,
+                              GLsizei layers);
+    // immutable storage with flags when available, GL_STREAM_DRAW data store otherwise
+    GLuint createBuffer(GLenum target, GLsizeiptr size, const void *data, GLbitfield flags);
+    // framebuffer rendering into level 0 of colorTexture, exits when incomplete
+    GLuint createFramebuffer(GLuint colorTexture);
+    void deleteTexture(GLuint texture);
+    void deleteBuffer(GLuint buffer);
+    void deleteFramebuffer(GLuint framebuffer);
+
+    void *mapBuffer(GLenum target, GLuint buffer, GLintptr offset, GLsizeiptr length,
+                    GLbitfield access);
+    void unmapBuffer(GLenum target, GLuint buffer);
+    // buffer needs GL_DYNAMIC_STORAGE_BIT when created with storage flags
+    void bufferSubData(GLenum target, GLuint buffer, GLintptr offset, GLsizeiptr size,
+                       const void *data);
+    // pixels is an offset into the bound GL_PIXEL_UNPACK_BUFFER, or client memory if none
+    void texSubImage2D(GLuint texture, GLsizei width, GLsizei height, GLenum format, GLenum type,
+                       const void *pixels);
+    // the same for one layer of an array texture
+    void texSubImage3D(GLuint texture, GLint layer, GLsizei width, GLsizei height, GLenum format,
+                       GLenum type, const void *pixels);
+
+    // GL calls made through this object and binds skipped as redundant
+    uint64_t issued() const { return mIssued.load(std::memory_order_relaxed); }
+    uint64_t skipped() const { return mSkipped.load(std::memory_order_relaxed); }
+
+private:
+    static constexpr GLuint unknown = ~0u;
+    static constexpr GLuint textureUnits = 8;
+
+    // index into mBuffers, -1 for targets that are not cached
+    static int bufferIndex(GLenum target);
+    void activeTexture(GLuint unit);
+    // texture of target with filtering and wrapping set up for internalFormat, no storage
+    GLuint genTexture(GLenum target, GLenum internalFormat);
+    bool changed(GLuint &cached, GLuint value);
+    void count(uint64_t calls = 1) { mIssued.fetch_add(calls, std::memory_order_relaxed); }
+
+    bool mDsa = false;
+    bool mTextureStorage = false;
+    bool mBufferStorage = false;
+
+    std::array<GLuint, 4> mBuffers{};
+    GLuint mVertexArray = unknown;
+    GLuint mProgram = unknown;
+    GLuint mActiveUnit = unknown;
+    std::array<GLuint, textureUnits> mTextures{};
+    std::array<GLuint, textureUnits> mTextureArrays{};
+    GLint mUnpackAlignment = -1;
+    GLint mUnpackRowLength = -1;
+    GLuint mFramebuffer = unknown;
+
+    std::atomic<uint64_t> mIssued = 0;
+    std::atomic<uint64_t> mSkipped = 0;
+};
+
+#endif // GLSTATE_H
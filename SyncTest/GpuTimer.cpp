@@ -0,0 +1,68 @@
+#include "GpuTimer.h"
+
+#include <cstdio>
+
+GpuTimer::GpuTimer(uint32_t ringSize) : mRingSize(ringSize) {}
+
+GpuTimer::~GpuTimer()
+{
+    if (!mQueries.empty()) {
+        printf("Error: GpuTimer destroyed with live queries\n");
+    }
+}
+
+void GpuTimer::begin()
+{
+    if (mQueries.empty()) {
+        mQueries.resize(mRingSize);
+        glGenQueries(mRingSize, mQueries.data());
+    }
+    collect();
+    if (mPending == mRingSize) {
+        mDropped++;
+        return;
+    }
+    glBeginQuery(GL_TIME_ELAPSED, mQueries[(mFirst + mPending) % mRingSize]);
+    mActive = true;
+}
+
+void GpuTimer::end()
+{
+    if (!mActive) {
+        return;
+    }
+    glEndQuery(GL_TIME_ELAPSED);
+    mActive = false;
+    mPending++;
+}
+
+void GpuTimer::collect()
+{
+    while (mPending) {
+        const GLuint query = mQueries[mFirst];
+        GLint available = 0;
+        glGetQueryObjectiv(query, GL_QUERY_RESULT_AVAILABLE, &available);
+        if (!available) {
+            return;
+        }
+        GLuint64 elapsedNs = 0;
+        glGetQueryObjectui64v(query, GL_QUERY_RESULT, &elapsedNs);
+        mStats.add(elapsedNs / 1e6);
+        mFirst = (mFirst + 1) % mRingSize;
+        mPending--;
+    }
+}
+
+void GpuTimer::destroy()
+{
+    if (mQueries.empty()) {
+        return;
+    }
+    if (mActive) {
+        end();
+    }
+    // results of the last few frames are not worth a stall
+    glDeleteQueries(mRingSize, mQueries.data());
+    mQueries.clear();
+    mPending = 0;
+}
@@ -0,0 +1,43 @@
+#ifndef GPUTIMER_H
+#define GPUTIMER_H
+
+#include <cstdint>
+#include <vector>
+
+#include "glad/gl.h"
+
+#include "TimingStats.h"
+
+// Measures GPU execution time of the commands between begin() and end() with a ring of
+// GL_TIME_ELAPSED queries that are read back a few frames later, so nothing stalls. When the
+// ring is full the measurement is dropped instead of waiting.
+// Query objects are not shared between contexts: every method has to be called with the same
+// context current, queries are created on first use and deleted by destroy().
+class GpuTimer
+{
+public:
+    explicit GpuTimer(uint32_t ringSize = 8);
+    ~GpuTimer();
+
+    void begin();
+    void end();
+    // reads back the finished queries without waiting
+    void collect();
+    void destroy();
+
+    const TimingStats &stats() const { return mStats; }
+    uint64_t dropped() const { return mDropped; }
+
+private:
+    std::vector<GLuint> mQueries;
+    uint32_t mRingSize = 0;
+    // queries issued and not read back yet are [mFirst, mFirst + mPending)
+    uint32_t mFirst = 0;
+    uint32_t mPending = 0;
+    bool mActive = false;
+
+    TimingStats mStats;
+    uint64_t mDropped = 0;
+};
+
+#endif // GPUTIMER_H
@@ -0,0 +1,125 @@
+#include "HalfFloat.h"
+
+#include <cstring>
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#define HALFFLOAT_X86
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+#endif
+
+#ifdef HALFFLOAT_X86
+namespace {
+// MSVC compiles intrinsics for any target, GCC and Clang only in functions built for it
+#if defined(_MSC_VER) && !defined(__clang__)
+#define F16C_TARGET
+#else
+#define F16C_TARGET __attribute__((target("avx,f16c")))
+#endif
+
+// F16C and AVX in the processor, and the YMM registers saved by the system
+bool hasF16c()
+{
+    unsigned ecx = 0;
+#ifdef _MSC_VER
+    int info[4] = {};
+    __cpuid(info, 1);
+    ecx = static_cast<unsigned>(info[2]);
+#else
+    unsigned eax = 0;
+    unsigned ebx = 0;
+    unsigned edx = 0;
+    if (!__get_cpuid(1, &eax, &ebx, &ecx, &edx)) {
+        return false;
+    }
+#endif
+    const unsigned osxsave = 1u << 27;
+    const unsigned avx = 1u << 28;
+    const unsigned f16c = 1u << 29;
+    if ((ecx & (osxsave | avx | f16c)) != (osxsave | avx | f16c)) {
+        return false;
+    }
+#ifdef _MSC_VER
+    const unsigned long long xcr0 = _xgetbv(0);
+#else
+    unsigned low = 0;
+    unsigned high = 0;
+    __asm__("xgetbv" : "=a"(low), "=d"(high) : "c"(0));
+    const unsigned long long xcr0 = low | static_cast<unsigned long long>(high) << 32;
+#endif
+    return (xcr0 & 6) == 6;
+}
+
+// converts whole groups of eight, returns how many values it did
+F16C_TARGET size_t convertToHalfF16c(const float *src, uint8_t *dst, size_t count)
+{
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        const __m256 values = _mm256_loadu_ps(src + i);
+        const __m128i halves = _mm256_cvtps_ph(values, _MM_FROUND_TO_NEAREST_INT);
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + i * sizeof(uint16_t)), halves);
+    }
+    return i;
+}
+} // namespace
+#endif
+
+uint16_t floatToHalf(float value)
+{
+    uint32_t bits = 0;
+    std::memcpy(&bits, &value, sizeof(bits));
+    const uint32_t sign = (bits >> 16) & 0x8000;
+    const uint32_t magnitude = bits & 0x7fffffff;
+
+    if (magnitude >= 0x7f800000) {
+        // infinity stays infinity, NaN becomes quiet and keeps the top of its payload
+        const uint32_t nan = magnitude > 0x7f800000 ? 0x200 | (magnitude & 0x7fffff) >> 13 : 0;
+        return static_cast<uint16_t>(sign | 0x7c00 | nan);
+    }
+    if (magnitude >= 0x477ff000) {
+        // 65520 and above round past the largest half
+        return static_cast<uint16_t>(sign | 0x7c00);
+    }
+    if (magnitude < 0x38800000) {
+        // below the smallest normal half: subnormal or zero
+        if (magnitude < 0x33000000) {
+            return static_cast<uint16_t>(sign);
+        }
+        const uint32_t shift = 126 - (magnitude >> 23);
+        const uint32_t mantissa = (magnitude & 0x7fffff) | 0x800000;
+        uint32_t half = mantissa >> shift;
+        const uint32_t rest = mantissa & ((1u << shift) - 1);
+        const uint32_t halfway = 1u << (shift - 1);
+        if (rest > halfway || (rest == halfway && (half & 1))) {
+            half++;
+        }
+        return static_cast<uint16_t>(sign | half);
+    }
+    // rebias the exponent and round the mantissa from 23 to 10 bits, a carry may bump the
+    // exponent which is still the right result
+    uint32_t half = (magnitude - 0x38000000) >> 13;
+    const uint32_t rest = magnitude & 0x1fff;
+    if (rest > 0x1000 || (rest == 0x1000 && (half & 1))) {
+        half++;
+    }
+    return static_cast<uint16_t>(sign | half);
+}
+
+void convertToHalf(const float *src, uint8_t *dst, size_t count)
+{
+    size_t i = 0;
+#ifdef HALFFLOAT_X86
+    static const bool f16c = hasF16c();
+    if (f16c) {
+        i = convertToHalfF16c(src, dst, count);
+    }
+#endif
+    for (; i < count; ++i) {
+        const uint16_t half = floatToHalf(src[i]);
+        std::memcpy(dst + i * sizeof(half), &half, sizeof(half));
+    }
+}
@@ -0,0 +1,15 @@
+#ifndef HALFFLOAT_H
+#define HALFFLOAT_H
+
+#include <cstddef>
+#include <cstdint>
+
+// IEEE 754 binary16 of value, rounded to nearest even like the hardware conversion
+uint16_t floatToHalf(float value);
+
+// Converts count floats into native-endian halves at dst. Uses _mm256_cvtps_ph for eight values
+// at a time on x86 processors with F16C, detected at run time, the scalar conversion elsewhere;
+// both round the same way.
+void convertToHalf(const float *src, uint8_t *dst, size_t count);
+
+#endif // HALFFLOAT_H
@@ -0,0 +1,130 @@
+#include "HandoffManager.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+
+HandoffManager::~HandoffManager()
+{
+    for (auto &[id, batch] : mBatches) {
+        glDeleteSync(batch.sync);
+    }
+}
+
+void HandoffManager::recordWrite(SDL_GLContext writer, GLuint texture)
+{
+    std::lock_guard guard(mMutex);
+    TextureState &state = mTextures[texture];
+    if (state.batch) {
+        // overwritten before anybody read it
+        auto it = mBatches.find(state.batch);
+        if (it != mBatches.end() && --it->second.pending == 0) {
+            destroyBatch(it);
+        }
+    }
+    state.writer = writer;
+    state.batch = 0;
+    mOpenWrites[writer].push_back(texture);
+}
+
+uint64_t HandoffManager::submit(SDL_GLContext writer)
+{
+    std::lock_guard guard(mMutex);
+    auto &writes = mOpenWrites[writer];
+    if (writes.empty()) {
+        return 0;
+    }
+
+    const uint64_t id = mNextBatch++;
+    Batch &batch = mBatches[id];
+    batch.sync = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    // the fence has to reach the GPU before another context can wait for it
+    glFlush();
+    mFences++;
+
+    for (const GLuint texture : writes) {
+        TextureState &state = mTextures[texture];
+        if (state.writer == writer && !state.batch) {
+            state.batch = id;
+            batch.pending++;
+        }
+    }
+    writes.clear();
+    if (!batch.pending) {
+        destroyBatch(mBatches.find(id));
+        return 0;
+    }
+    return id;
+}
+
+GLsync HandoffManager::retain(uint64_t batch)
+{
+    std::lock_guard guard(mMutex);
+    auto it = mBatches.find(batch);
+    if (it == mBatches.end()) {
+        return 0;
+    }
+    it->second.pending++;
+    return it->second.sync;
+}
+
+void HandoffManager::release(uint64_t batch)
+{
+    std::lock_guard guard(mMutex);
+    auto it = mBatches.find(batch);
+    if (it != mBatches.end() && --it->second.pending == 0) {
+        destroyBatch(it);
+    }
+}
+
+void HandoffManager::acquire(SDL_GLContext reader, GLuint texture)
+{
+    std::lock_guard guard(mMutex);
+    auto textureIt = mTextures.find(texture);
+    if (textureIt == mTextures.end() || textureIt->second.writer == reader) {
+        // never written or written on the same context: ordered by the command stream
+        return;
+    }
+    TextureState &state = textureIt->second;
+    if (!state.batch) {
+        const auto &writes = mOpenWrites[state.writer];
+        if (std::find(writes.begin(), writes.end(), texture) != writes.end()) {
+            printf("Error: texture %u acquired before its upload was submitted\n", texture);
+            exit(1);
+        }
+        // already handed over
+        return;
+    }
+
+    auto it = mBatches.find(state.batch);
+    state.batch = 0;
+    if (it == mBatches.end()) {
+        return;
+    }
+    Batch &batch = it->second;
+    mHandoffs++;
+    if (std::find(batch.waited.begin(), batch.waited.end(), reader) == batch.waited.end()) {
+        glWaitSync(batch.sync, 0, GL_TIMEOUT_IGNORED);
+        batch.waited.push_back(reader);
+        mWaits++;
+    }
+    if (--batch.pending == 0) {
+        destroyBatch(it);
+    }
+}
+
+void HandoffManager::destroyBatch(std::map<uint64_t, Batch>::iterator it)
+{
+    // deletion is deferred by GL until pending server waits are done
+    glDeleteSync(it->second.sync);
+    mBatches.erase(it);
+}
+
+void HandoffManager::printStats() const
+{
+    std::lock_guard guard(mMutex);
+    printf("Handoff: %llu textures in %llu fences, %llu server waits (%.2f textures per fence)\n",
+           static_cast<unsigned long long>(mHandoffs), static_cast<unsigned long long>(mFences),
+           static_cast<unsigned long long>(mWaits),
+           mFences ? static_cast<double>(mHandoffs) / mFences : 0.0);
+}
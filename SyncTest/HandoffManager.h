@@ -0,0 +1,69 @@
+#ifndef HANDOFFMANAGER_H
+#define HANDOFFMANAGER_H
+
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#include "SDL2/SDL.h"
+#include "glad/gl.h"
+
+// Hands textures written on one context over to another. Remembers which context wrote each
+// texture last and fences all writes of one producer submission with a single GLsync, so the
+// consumer issues one glWaitSync per batch instead of one per texture.
+// Thread safe; every method is called with the named context current.
+class HandoffManager
+{
+public:
+    HandoffManager() = default;
+    HandoffManager(const HandoffManager &) = delete;
+    HandoffManager &operator=(const HandoffManager &) = delete;
+    ~HandoffManager();
+
+    // texture was written by commands issued on writer since its last submit()
+    void recordWrite(SDL_GLContext writer, GLuint texture);
+    // fences every write recorded on writer with one sync object and flushes it, returns the
+    // batch id or 0 if nothing was written
+    uint64_t submit(SDL_GLContext writer);
+
+    // keeps the fence of a batch alive until release() in addition to its textures
+    GLsync retain(uint64_t batch);
+    void release(uint64_t batch);
+
+    // makes reader wait for the last write of texture, at most once per batch
+    void acquire(SDL_GLContext reader, GLuint texture);
+
+    void printStats() const;
+
+private:
+    struct Batch
+    {
+        GLsync sync = 0;
+        // textures of the batch not acquired yet and retains, the fence is deleted at zero
+        uint32_t pending = 0;
+        std::vector<SDL_GLContext> waited;
+    };
+
+    struct TextureState
+    {
+        SDL_GLContext writer = nullptr;
+        // 0 while the write is not submitted or after it was acquired
+        uint64_t batch = 0;
+    };
+
+    void destroyBatch(std::map<uint64_t, Batch>::iterator it);
+
+    mutable std::mutex mMutex;
+    std::unordered_map<GLuint, TextureState> mTextures;
+    std::unordered_map<SDL_GLContext, std::vector<GLuint>> mOpenWrites;
+    std::map<uint64_t, Batch> mBatches;
+    uint64_t mNextBatch = 1;
+
+    uint64_t mHandoffs = 0;
+    uint64_t mFences = 0;
+    uint64_t mWaits = 0;
+};
+
+#endif // HANDOFFMANAGER_H
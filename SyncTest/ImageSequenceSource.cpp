@@ -0,0 +1,146 @@
+#include "ImageSequenceSource.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+
+#include "SDL2/SDL_timer.h"
+
+#include "Frame.h"
+
+namespace {
+bool fileExists(const std::string &path)
+{
+    if (FILE *file = fopen(path.c_str(), "rb")) {
+        fclose(file);
+        return true;
+    }
+    return false;
+}
+
+// blocking reads need about one thread per read in flight to keep the queue deep
+const uint32_t maxReadThreads = 32;
+} // namespace
+
+ImageSequenceSource::ImageSequenceSource(const std::string &pattern, const FrameFormat &format,
+                                         uint32_t streams, uint32_t readAhead)
+    : mPattern(pattern), mFormat(format), mStreams(streams), mReadAhead(readAhead),
+      mStreamState(streams)
+{
+    mFirstIndex = fileExists(path(0)) ? 0 : 1;
+    while (fileExists(path(mFirstIndex + mFrameCount))) {
+        mFrameCount++;
+    }
+    if (!mFrameCount) {
+        printf("No file matches %s\n", pattern.c_str());
+        exit(1);
+    }
+
+    const uint32_t buffers = mStreams * mReadAhead;
+    const uint32_t threads = std::min(buffers, maxReadThreads);
+    mReader = std::make_unique<AsyncFrameReader>(buffers, mFormat.sourceFrameBytes(), threads);
+    printf("Playing %s: %llu %ux%u %s frames, %u reads in flight per stream through %s\n",
+           pattern.c_str(), static_cast<unsigned long long>(mFrameCount), mFormat.width,
+           mFormat.height, pixelFormatName(mFormat.pixelFormat), mReadAhead,
+           mReader->backend());
+}
+
+std::string ImageSequenceSource::path(uint64_t index) const
+{
+    char name[4096];
+    snprintf(name, sizeof(name), mPattern.c_str(), static_cast<int>(index));
+    return name;
+}
+
+uint32_t ImageSequenceSource::buffer(uint32_t stream, uint64_t frame) const
+{
+    return stream * mReadAhead + static_cast<uint32_t>(frame % mReadAhead);
+}
+
+bool ImageSequenceSource::clipFrame(uint32_t stream, uint64_t frame, uint64_t &index) const
+{
+    index = (stream * mFrameCount / mStreams + frame) % mFrameCount;
+    return true;
+}
+
+std::string ImageSequenceSource::streamPath(uint32_t stream, uint64_t frame) const
+{
+    uint64_t index = 0;
+    clipFrame(stream, frame, index);
+    return path(mFirstIndex + index);
+}
+
+void ImageSequenceSource::request(uint32_t stream, uint64_t frame)
+{
+    mReader->submit(buffer(stream, frame), streamPath(stream, frame));
+}
+
+const uint8_t *ImageSequenceSource::frameData(uint32_t stream, uint64_t frame)
+{
+    Stream &state = mStreamState[stream];
+    if (!state.primed || frame != state.expected) {
+        // first frame or a jump, a new pipeline starts from 0: refill the whole window
+        for (uint64_t i = 0; i < mReadAhead; ++i) {
+            if (mReader->pending(buffer(stream, i))) {
+                mReader->wait(buffer(stream, i));
+            }
+        }
+        for (uint64_t i = 0; i < mReadAhead; ++i) {
+            request(stream, frame + i);
+        }
+        state.primed = true;
+        if (!state.firstTicks) {
+            state.firstTicks = SDL_GetPerformanceCounter();
+        }
+    } else {
+        // the previous frame was staged, its buffer takes the frame entering the window
+        request(stream, frame - 1 + mReadAhead);
+    }
+    state.expected = frame + 1;
+
+    for (uint64_t i = 0; i < mReadAhead; ++i) {
+        state.depthSum += mReader->pending(buffer(stream, frame + i)) ? 1 : 0;
+    }
+    const uint32_t current = buffer(stream, frame);
+    const uint64_t waitStart = SDL_GetPerformanceCounter();
+    if (mReader->pending(current)) {
+        state.stalls++;
+    }
+    const size_t bytes = mReader->wait(current);
+    state.lastTicks = SDL_GetPerformanceCounter();
+    state.waits.add((state.lastTicks - waitStart) * 1000.0 / SDL_GetPerformanceFrequency());
+    if (bytes < mFormat.sourceFrameBytes()) {
+        printf("%s holds %zu bytes, a %ux%u %s frame needs %zu\n",
+               streamPath(stream, frame).c_str(), bytes, mFormat.width,
+               mFormat.height, pixelFormatName(mFormat.pixelFormat), mFormat.sourceFrameBytes());
+        exit(1);
+    }
+    state.frames++;
+    state.bytes += bytes;
+    return mReader->data(current);
+}
+
+void ImageSequenceSource::readFrame(uint32_t stream, uint64_t frame, uint8_t *dst, size_t pitch)
+{
+    const size_t rowBytes = mFormat.sourceRowBytes();
+    copyRows(dst, pitch, frameData(stream, frame), rowBytes, rowBytes, mFormat.uploadHeight());
+}
+
+void ImageSequenceSource::printStats() const
+{
+    const double ticksPerSecond = static_cast<double>(SDL_GetPerformanceFrequency());
+    for (uint32_t i = 0; i < mStreams; ++i) {
+        const Stream &state = mStreamState[i];
+        if (!state.frames) {
+            continue;
+        }
+        const double seconds = (state.lastTicks - state.firstTicks) / ticksPerSecond;
+        printf("Sequence stream %u: %llu frames, %.1f MB, %.1f MB/s, queue depth avg %.1f, "
+               "%llu stalls\n",
+               i, static_cast<unsigned long long>(state.frames), state.bytes / 1e6,
+               seconds > 0 ? state.bytes / 1e6 / seconds : 0.0,
+               static_cast<double>(state.depthSum) / state.frames,
+               static_cast<unsigned long long>(state.stalls));
+        state.waits.print("read waits");
+    }
+}
@@ -0,0 +1,70 @@
+#ifndef IMAGESEQUENCESOURCE_H
+#define IMAGESEQUENCESOURCE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "AsyncFrameReader.h"
+#include "FrameSource.h"
+#include "TimingStats.h"
+
+// Plays an image sequence, one raw frame per file, named by a printf pattern such as
+// frames/%06d.raw and numbered from 0 or 1. Every stream keeps readAhead files in flight
+// ahead of the frame it plays through an AsyncFrameReader, so the device sees a deep queue;
+// a frame is handed to staging straight from its read buffer. The sequence loops, the
+// streams play it shifted by an equal share of its length.
+class ImageSequenceSource : public FrameSource
+{
+public:
+    // exits if no file matches the pattern
+    ImageSequenceSource(const std::string &pattern, const FrameFormat &format, uint32_t streams,
+                        uint32_t readAhead);
+
+    const char *name() const override { return "sequence"; }
+    const FrameFormat &format() const override { return mFormat; }
+    bool clipFrame(uint32_t stream, uint64_t frame, uint64_t &index) const override;
+
+    const uint8_t *frameData(uint32_t stream, uint64_t frame) override;
+    void readFrame(uint32_t stream, uint64_t frame, uint8_t *dst, size_t pitch) override;
+
+    void printStats() const override;
+
+private:
+    struct Stream
+    {
+        // frame expected next, the window is queued anew after a jump
+        uint64_t expected = 0;
+        bool primed = false;
+
+        uint64_t frames = 0;
+        uint64_t bytes = 0;
+        uint64_t firstTicks = 0;
+        uint64_t lastTicks = 0;
+        // reads in flight summed over every frame played, for the average queue depth
+        uint64_t depthSum = 0;
+        // frames whose read was still in flight when they were needed
+        uint64_t stalls = 0;
+        TimingStats waits;
+    };
+
+    std::string path(uint64_t index) const;
+    // file played as frame of stream
+    std::string streamPath(uint32_t stream, uint64_t frame) const;
+    uint32_t buffer(uint32_t stream, uint64_t frame) const;
+    void request(uint32_t stream, uint64_t frame);
+
+    std::string mPattern;
+    FrameFormat mFormat;
+    const uint32_t mStreams = 1;
+    const uint32_t mReadAhead = 1;
+    uint64_t mFirstIndex = 0;
+    uint64_t mFrameCount = 0;
+
+    std::unique_ptr<AsyncFrameReader> mReader;
+    std::vector<Stream> mStreamState;
+};
+
+#endif // IMAGESEQUENCESOURCE_H
@@ -0,0 +1,105 @@
+#include "MappedFile.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#ifdef _WIN32
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#ifdef _WIN32
+
+MappedFile::MappedFile(const std::string &path)
+{
+    HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+                              OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    LARGE_INTEGER size{};
+    if (file == INVALID_HANDLE_VALUE || !GetFileSizeEx(file, &size) || !size.QuadPart) {
+        printf("Failed to open %s\n", path.c_str());
+        exit(1);
+    }
+    HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    const void *data = mapping ? MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0) : nullptr;
+    if (!data) {
+        printf("Failed to map %s: error %lu\n", path.c_str(), GetLastError());
+        exit(1);
+    }
+    mFile = file;
+    mMapping = mapping;
+    mData = static_cast<const uint8_t *>(data);
+    mSize = static_cast<size_t>(size.QuadPart);
+}
+
+MappedFile::~MappedFile()
+{
+    UnmapViewOfFile(mData);
+    CloseHandle(mMapping);
+    CloseHandle(mFile);
+}
+
+void MappedFile::prefetch(size_t offset, size_t size) const
+{
+#if _WIN32_WINNT >= 0x0602
+    if (offset >= mSize) {
+        return;
+    }
+    WIN32_MEMORY_RANGE_ENTRY range;
+    range.VirtualAddress = const_cast<uint8_t *>(mData + offset);
+    range.NumberOfBytes = std::min(size, mSize - offset);
+    PrefetchVirtualMemory(GetCurrentProcess(), 1, &range, 0);
+#else
+    // Windows 7 has no prefetch call, the first accesses fault the pages in
+    (void)offset;
+    (void)size;
+#endif
+}
+
+#else
+
+MappedFile::MappedFile(const std::string &path)
+{
+    const int file = open(path.c_str(), O_RDONLY);
+    struct stat info = {};
+    if (file < 0 || fstat(file, &info) != 0 || !info.st_size) {
+        printf("Failed to open %s\n", path.c_str());
+        exit(1);
+    }
+    const size_t size = static_cast<size_t>(info.st_size);
+    void *data = mmap(nullptr, size, PROT_READ, MAP_SHARED, file, 0);
+    if (data == MAP_FAILED) {
+        printf("Failed to map %s: %s\n", path.c_str(), strerror(errno));
+        exit(1);
+    }
+    mFile = file;
+    mData = static_cast<const uint8_t *>(data);
+    mSize = size;
+}
+
+MappedFile::~MappedFile()
+{
+    munmap(const_cast<uint8_t *>(mData), mSize);
+    close(mFile);
+}
+
+void MappedFile::prefetch(size_t offset, size_t size) const
+{
+    if (offset >= mSize) {
+        return;
+    }
+    // madvise needs a page aligned start
+    static const size_t pageSize = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    const size_t begin = offset / pageSize * pageSize;
+    const size_t end = std::min(offset + size, mSize);
+    madvise(const_cast<uint8_t *>(mData + begin), end - begin, MADV_WILLNEED);
+}
+
+#endif
@@ -0,0 +1,38 @@
+#ifndef MAPPEDFILE_H
+#define MAPPEDFILE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// Whole file mapped read-only, mmap or CreateFileMapping. Pages are read in on first access;
+// prefetch() asks for a range ahead of time with madvise(MADV_WILLNEED), or
+// PrefetchVirtualMemory on Windows 8 and later.
+class MappedFile
+{
+public:
+    // exits if the file cannot be opened, is empty or cannot be mapped
+    explicit MappedFile(const std::string &path);
+    ~MappedFile();
+
+    MappedFile(const MappedFile &) = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+
+    const uint8_t *data() const { return mData; }
+    size_t size() const { return mSize; }
+
+    // clamped to the file
+    void prefetch(size_t offset, size_t size) const;
+
+private:
+    const uint8_t *mData = nullptr;
+    size_t mSize = 0;
+#ifdef _WIN32
+    void *mFile = nullptr;
+    void *mMapping = nullptr;
+#else
+    int mFile = -1;
+#endif
+};
+
+#endif // MAPPEDFILE_H
@@ -0,0 +1,47 @@
+#include "MaskPack.h"
+
+#include <cstring>
+
+// MSVC does not define __SSE2__: x64 always has it, x86 with /arch:SSE2 or above
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define MASKPACK_SSE2
+#endif
+
+#if defined(__AVX2__) || defined(MASKPACK_SSE2)
+#include <immintrin.h>
+#endif
+
+namespace {
+// words go through memcpy, the destination is a byte buffer such as a mapped arena range
+void storeWord(uint8_t *bits, size_t word, uint32_t value)
+{
+    std::memcpy(bits + word * sizeof(value), &value, sizeof(value));
+}
+} // namespace
+
+void packMask(const uint8_t *values, uint8_t *bits, size_t count)
+{
+    size_t i = 0;
+#if defined(__AVX2__)
+    for (; i + 32 <= count; i += 32) {
+        const __m256i chunk = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(values + i));
+        storeWord(bits, i / 32, static_cast<uint32_t>(_mm256_movemask_epi8(chunk)));
+    }
+#elif defined(MASKPACK_SSE2)
+    for (; i + 32 <= count; i += 32) {
+        const __m128i low = _mm_loadu_si128(reinterpret_cast<const __m128i *>(values + i));
+        const __m128i high = _mm_loadu_si128(reinterpret_cast<const __m128i *>(values + i + 16));
+        storeWord(bits, i / 32,
+                  static_cast<uint32_t>(_mm_movemask_epi8(low))
+                      | static_cast<uint32_t>(_mm_movemask_epi8(high)) << 16);
+    }
+#endif
+    // the rest, everything without SIMD
+    for (; i < count; i += 32) {
+        uint32_t word = 0;
+        for (size_t bit = 0; bit < 32 && i + bit < count; ++bit) {
+            word |= static_cast<uint32_t>(values[i + bit] >> 7) << bit;
+        }
+        storeWord(bits, i / 32, word);
+    }
+}
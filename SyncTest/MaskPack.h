@@ -0,0 +1,13 @@
+#ifndef MASKPACK_H
+#define MASKPACK_H
+
+#include <cstddef>
+#include <cstdint>
+
+// Packs count 8-bit values into bits, one per value, set where the value is 128 or more.
+// Value i lands in bit i % 32 of the native-endian 32-bit word i / 32, the unused bits of the
+// last word are cleared. Uses movemask on SSE2 and AVX2 builds, which picks exactly the top bit
+// of every byte.
+void packMask(const uint8_t *values, uint8_t *bits, size_t count);
+
+#endif // MASKPACK_H
@@ -0,0 +1,205 @@
+#include "Options.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+namespace {
+const uint32_t benchmarkFrames = 600;
+
+void printUsage()
+{
+    printf("Usage: SyncTest [options]\n"
+           "  --upload-mode shared|single|vram\n"
+           "                               texture upload design (default shared)\n"
+           "  --streams N                  number of streams uploaded per frame (default 1)\n"
+           "  --staging-buffers N          frames staged per stream (default 2)\n"
+           "  --upload-format auto|rgba8|rgb8|r8|mask1|v210|rgba16f\n"
+           "                               texture format of the streams (default: content)\n"
+           "  --source FILE|PATTERN        play a raw, Y4M or tile file, or an image sequence\n"
+           "                               such as frames/%%06d.raw (default: generated bars)\n"
+           "  --source shm:NAME            receive the frames of a running ShmWriter NAME\n"
+           "  --source tcp:[HOST:]PORT|unix:PATH\n"
+           "                               receive frames from a running SocketSender\n"
+           "  --source-size WxH            frame size of raw files (default 1920x1080)\n"
+           "  --read-ahead N               sequence files read ahead per stream (default 8)\n"
+           "  --decode-threads N           tile containers: threads decoding a frame\n"
+           "                               (default: one per core)\n"
+           "  --frame-cache MB             keep decoded frames of the looped content in up to\n"
+           "                               MB of RAM (default 0: off)\n"
+           "  --upload-ahead N             single mode: frames uploaded ahead (default 1)\n"
+           "  --vram-budget MB             vram mode: video memory for the clip (default 2048)\n"
+           "  --frames N                   stop after N frames (default: until closed)\n"
+           "  --benchmark                  run all upload modes for --frames (default %u)\n"
+           "  --outputs N                  warp and blend N projector outputs (default: off)\n"
+           "  --blend-overlap PERCENT      overlap of neighbouring outputs (default 10)\n"
+           "  --warp-keystone PERCENT      narrow the bottom of every output (default 0)\n"
+           "  --shader-cache DIR|off       program binary cache (default: per-user directory)\n"
+           "  --gl-errors frame|debug|off  glGetError every frame, debug context output or\n"
+           "                               no error checks at all (default frame)\n"
+           "  --gl-debug-severity notification|low|medium|high\n"
+           "                               lowest debug message severity (default notification)\n"
+           "  --gl-debug-ignore ID         disable debug message ID, may be repeated\n",
+           benchmarkFrames);
+}
+
+uint32_t parseUint(const char *name, const char *value)
+{
+    char *end = nullptr;
+    const unsigned long result = strtoul(value, &end, 10);
+    if (!*value || *end) {
+        printf("Invalid value for %s: %s\n", name, value);
+        exit(1);
+    }
+    return static_cast<uint32_t>(result);
+}
+} // namespace
+
+const char *uploadModeName(UploadMode mode)
+{
+    switch (mode) {
+    case UploadMode::SharedContext: return "shared";
+    case UploadMode::SingleContext: return "single";
+    case UploadMode::VramClip: return "vram";
+    }
+    return "unknown";
+}
+
+Options parseOptions(int argc, char **argv)
+{
+    Options options;
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        auto value = [&]() -> const char * {
+            if (i + 1 >= argc) {
+                printf("Missing value for %s\n", arg.c_str());
+                exit(1);
+            }
+            return argv[++i];
+        };
+
+        if (arg == "--upload-mode") {
+            const std::string mode = value();
+            if (mode == uploadModeName(UploadMode::SharedContext)) {
+                options.uploadMode = UploadMode::SharedContext;
+            } else if (mode == uploadModeName(UploadMode::SingleContext)) {
+                options.uploadMode = UploadMode::SingleContext;
+            } else if (mode == uploadModeName(UploadMode::VramClip)) {
+                options.uploadMode = UploadMode::VramClip;
+            } else {
+                printf("Unknown upload mode: %s\n", mode.c_str());
+                exit(1);
+            }
+        } else if (arg == "--streams") {
+            options.streams = parseUint(arg.c_str(), value());
+            if (!options.streams) {
+                printf("At least one stream is required\n");
+                exit(1);
+            }
+        } else if (arg == "--staging-buffers") {
+            options.stagingBuffers = parseUint(arg.c_str(), value());
+            if (!options.stagingBuffers) {
+                printf("At least one staging buffer is required\n");
+                exit(1);
+            }
+        } else if (arg == "--upload-format") {
+            const std::string format = value();
+            PixelFormat pixelFormat;
+            if (format == "auto") {
+                options.uploadFormat.reset();
+            } else if (parsePixelFormat(format, pixelFormat)) {
+                options.uploadFormat = pixelFormat;
+            } else {
+                printf("Unknown upload format: %s\n", format.c_str());
+                exit(1);
+            }
+        } else if (arg == "--source") {
+            options.source = value();
+        } else if (arg == "--source-size") {
+            const char *size = value();
+            unsigned width = 0;
+            unsigned height = 0;
+            char end = 0;
+            if (sscanf(size, "%ux%u%c", &width, &height, &end) != 2 || !width || !height) {
+                printf("Invalid value for %s: %s\n", arg.c_str(), size);
+                exit(1);
+            }
+            options.sourceWidth = width;
+            options.sourceHeight = height;
+        } else if (arg == "--read-ahead") {
+            options.readAhead = parseUint(arg.c_str(), value());
+            if (!options.readAhead) {
+                printf("At least one file has to be read ahead\n");
+                exit(1);
+            }
+        } else if (arg == "--decode-threads") {
+            options.decodeThreads = parseUint(arg.c_str(), value());
+        } else if (arg == "--frame-cache") {
+            options.frameCacheMegabytes = parseUint(arg.c_str(), value());
+        } else if (arg == "--upload-ahead") {
+            options.uploadAhead = parseUint(arg.c_str(), value());
+        } else if (arg == "--vram-budget") {
+            options.vramBudgetMegabytes = parseUint(arg.c_str(), value());
+        } else if (arg == "--frames") {
+            options.frames = parseUint(arg.c_str(), value());
+        } else if (arg == "--benchmark") {
+            options.benchmark = true;
+        } else if (arg == "--outputs") {
+            options.outputs = parseUint(arg.c_str(), value());
+        } else if (arg == "--blend-overlap") {
+            options.blendOverlap = parseUint(arg.c_str(), value());
+            if (options.blendOverlap >= 50) {
+                printf("Blend overlap has to be below 50%%\n");
+                exit(1);
+            }
+        } else if (arg == "--warp-keystone") {
+            options.warpKeystone = parseUint(arg.c_str(), value());
+            if (options.warpKeystone >= 100) {
+                printf("Keystone has to be below 100%%\n");
+                exit(1);
+            }
+        } else if (arg == "--shader-cache") {
+            options.shaderCache = value();
+        } else if (arg == "--gl-errors") {
+            const std::string check = value();
+            if (check == "frame") {
+                options.glErrorCheck = GlErrorCheck::Frame;
+            } else if (check == "debug") {
+                options.glErrorCheck = GlErrorCheck::Debug;
+            } else if (check == "off") {
+                options.glErrorCheck = GlErrorCheck::Off;
+            } else {
+                printf("Unknown GL error check: %s\n", check.c_str());
+                exit(1);
+            }
+        } else if (arg == "--gl-debug-severity") {
+            const std::string severity = value();
+            if (severity == "notification") {
+                options.glDebugMinSeverity = GL_DEBUG_SEVERITY_NOTIFICATION;
+            } else if (severity == "low") {
+                options.glDebugMinSeverity = GL_DEBUG_SEVERITY_LOW;
+            } else if (severity == "medium") {
+                options.glDebugMinSeverity = GL_DEBUG_SEVERITY_MEDIUM;
+            } else if (severity == "high") {
+                options.glDebugMinSeverity = GL_DEBUG_SEVERITY_HIGH;
+            } else {
+                printf("Unknown debug severity: %s\n", severity.c_str());
+                exit(1);
+            }
+        } else if (arg == "--gl-debug-ignore") {
+            options.glDebugIgnoredIds.push_back(parseUint(arg.c_str(), value()));
+        } else if (arg == "--help") {
+            printUsage();
+            exit(0);
+        } else {
+            printf("Unknown option: %s\n", arg.c_str());
+            printUsage();
+            exit(1);
+        }
+    }
+    if (options.benchmark && !options.frames) {
+        options.frames = benchmarkFrames;
+    }
+    return options;
+}
@@ -0,0 +1,81 @@
+#ifndef OPTIONS_H
+#define OPTIONS_H
+
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "glad/gl.h"
+
+#include "PixelFormat.h"
+
+enum class UploadMode {
+    // upload thread owns a shared context, render context waits with glWaitSync
+    SharedContext,
+    // CPU threads only fill mapped PBOs, render context uploads them itself
+    SingleContext,
+    // the looped clip is uploaded once into array textures, playback only selects layers
+    VramClip,
+};
+
+const char *uploadModeName(UploadMode mode);
+
+enum class GlErrorCheck {
+    // glGetError after every swap, synchronizes with the driver on many implementations
+    Frame,
+    // debug contexts with glDebugMessageCallback, no per-frame queries
+    Debug,
+    // release: no error queries at all
+    Off,
+};
+
+struct Options
+{
+    UploadMode uploadMode = UploadMode::SharedContext;
+    // independent video streams, each one drawn as a layer of the output
+    uint32_t streams = 1;
+    // frames per stream the upload arena stages, independent of the texture ring
+    uint32_t stagingBuffers = 2;
+    // texture format of the streams, unset to use the one the content declares
+    std::optional<PixelFormat> uploadFormat;
+    // uncompressed raw or Y4M file, or a printf pattern of an image sequence with one raw
+    // frame per file, played instead of the generated bars; empty for the bars
+    std::string source;
+    // frame size of raw source files, 0 for the size of the generated frames
+    uint32_t sourceWidth = 0;
+    uint32_t sourceHeight = 0;
+    // image sequences: files read ahead of the played frame per stream
+    uint32_t readAhead = 8;
+    // tile containers: threads decoding a frame, 0 for one per core
+    uint32_t decodeThreads = 0;
+    // RAM for frames of the looped content kept decoded, 0 to produce every frame anew
+    uint32_t frameCacheMegabytes = 0;
+    // single context mode: how many frames ahead of drawing the texture uploads are issued
+    uint32_t uploadAhead = 1;
+    // vram mode: video memory the clip may take, streaming is used for longer clips
+    uint32_t vramBudgetMegabytes = 2048;
+    // stop after this many frames, 0 to run until the window is closed
+    uint32_t frames = 0;
+    // run every upload mode for the same number of frames and compare
+    bool benchmark = false;
+
+    // projector outputs warped and blended side by side, 0 draws the streams directly
+    uint32_t outputs = 0;
+    // overlap of neighbouring outputs in percent of the output width
+    uint32_t blendOverlap = 10;
+    // bottom edge narrowing of every output in percent, exercises warp grid updates
+    uint32_t warpKeystone = 0;
+
+    // program binary cache directory, empty for the per-user default, "off" to disable
+    std::string shaderCache;
+
+    GlErrorCheck glErrorCheck = GlErrorCheck::Frame;
+    // debug output filters
+    GLenum glDebugMinSeverity = GL_DEBUG_SEVERITY_NOTIFICATION;
+    std::vector<GLuint> glDebugIgnoredIds;
+};
+
+Options parseOptions(int argc, char **argv);
+
+#endif // OPTIONS_H
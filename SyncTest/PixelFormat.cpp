@@ -0,0 +1,130 @@
+#include "PixelFormat.h"
+
+#include <cstdio>
+#include <cstdlib>
+
+namespace {
+const PixelFormat allFormats[] = {PixelFormat::RGBA8, PixelFormat::RGB8, PixelFormat::R8,
+                                  PixelFormat::Mask1, PixelFormat::V210, PixelFormat::RGBA16F,
+                                  PixelFormat::I420};
+
+const GLint grayscaleSwizzle[] = {GL_RED, GL_RED, GL_RED, GL_RED};
+
+const uint32_t maskPixelsPerTexel = 32;
+// v210 rows are whole blocks of 48 pixels in 128 bytes
+const uint32_t v210BlockPixels = 48;
+const uint32_t v210BlockTexels = 128 / 16;
+} // namespace
+
+const char *pixelFormatName(PixelFormat format)
+{
+    switch (format) {
+    case PixelFormat::RGBA8: return "rgba8";
+    case PixelFormat::RGB8: return "rgb8";
+    case PixelFormat::R8: return "r8";
+    case PixelFormat::Mask1: return "mask1";
+    case PixelFormat::V210: return "v210";
+    case PixelFormat::RGBA16F: return "rgba16f";
+    case PixelFormat::I420: return "i420";
+    }
+    return "unknown";
+}
+
+bool parsePixelFormat(const std::string &name, PixelFormat &format)
+{
+    for (const PixelFormat candidate : allFormats) {
+        if (name == pixelFormatName(candidate)) {
+            format = candidate;
+            return true;
+        }
+    }
+    return false;
+}
+
+size_t FrameFormat::rowBytes() const
+{
+    return static_cast<size_t>(uploadWidth()) * texelBytes();
+}
+
+size_t FrameFormat::sourceRowBytes() const
+{
+    if (pixelFormat == PixelFormat::RGBA16F) {
+        return static_cast<size_t>(width) * 4 * sizeof(float);
+    }
+    return rowBytes();
+}
+
+GLenum FrameFormat::internalFormat() const
+{
+    switch (pixelFormat) {
+    case PixelFormat::RGBA8: return GL_RGBA8;
+    case PixelFormat::RGB8: return GL_RGB8;
+    case PixelFormat::R8:
+    case PixelFormat::I420: return GL_R8;
+    case PixelFormat::Mask1: return GL_R32UI;
+    case PixelFormat::V210: return GL_RGBA32UI;
+    case PixelFormat::RGBA16F: return GL_RGBA16F;
+    }
+    printf("Unknown pixel format\n");
+    exit(1);
+}
+
+GLenum FrameFormat::glFormat() const
+{
+    switch (pixelFormat) {
+    case PixelFormat::RGBA8: return GL_RGBA;
+    case PixelFormat::RGB8: return GL_RGB;
+    case PixelFormat::R8:
+    case PixelFormat::I420: return GL_RED;
+    case PixelFormat::Mask1: return GL_RED_INTEGER;
+    case PixelFormat::V210: return GL_RGBA_INTEGER;
+    case PixelFormat::RGBA16F: return GL_RGBA;
+    }
+    printf("Unknown pixel format\n");
+    exit(1);
+}
+
+GLenum FrameFormat::glType() const
+{
+    switch (pixelFormat) {
+    case PixelFormat::Mask1:
+    case PixelFormat::V210: return GL_UNSIGNED_INT;
+    case PixelFormat::RGBA16F: return GL_HALF_FLOAT;
+    default: return GL_UNSIGNED_BYTE;
+    }
+}
+
+uint32_t FrameFormat::texelBytes() const
+{
+    switch (pixelFormat) {
+    case PixelFormat::RGBA8: return 4;
+    case PixelFormat::RGB8: return 3;
+    case PixelFormat::R8:
+    case PixelFormat::I420: return 1;
+    case PixelFormat::Mask1: return 4;
+    case PixelFormat::V210: return 16;
+    case PixelFormat::RGBA16F: return 8;
+    }
+    printf("Unknown pixel format\n");
+    exit(1);
+}
+
+uint32_t FrameFormat::uploadWidth() const
+{
+    switch (pixelFormat) {
+    case PixelFormat::Mask1: return (width + maskPixelsPerTexel - 1) / maskPixelsPerTexel;
+    case PixelFormat::V210:
+        return (width + v210BlockPixels - 1) / v210BlockPixels * v210BlockTexels;
+    default: return width;
+    }
+}
+
+uint32_t FrameFormat::uploadHeight() const
+{
+    return pixelFormat == PixelFormat::I420 ? height / 2 * 3 : height;
+}
+
+const GLint *FrameFormat::swizzle() const
+{
+    return pixelFormat == PixelFormat::R8 ? grayscaleSwizzle : nullptr;
+}
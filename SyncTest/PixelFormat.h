@@ -0,0 +1,59 @@
+#ifndef PIXELFORMAT_H
+#define PIXELFORMAT_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include "glad/gl.h"
+
+enum class PixelFormat {
+    RGBA8,
+    // packed rows of three bytes, alpha reads as one
+    RGB8,
+    // grayscale, the texture swizzle spreads the value over all four channels
+    R8,
+    // one bit per pixel, 32 pixels per R32UI texel with the leftmost in the lowest bit,
+    // expanded by the shader
+    Mask1,
+    // 10-bit 4:2:2 Y'CbCr, six pixels in four 32-bit words per RGBA32UI texel, rows padded to
+    // 128 bytes; unpacked on the GPU by V210Unpacker
+    V210,
+    // half floats for HDR, produced as 32-bit floats and converted while staged
+    RGBA16F,
+    // 8-bit 4:2:0 Y'CbCr planes one after another in an R8 texture of 3/2 the height, the
+    // chroma rows of half width packed two per texture row; converted by the shader
+    I420,
+};
+
+const char *pixelFormatName(PixelFormat format);
+// false for unknown names
+bool parsePixelFormat(const std::string &name, PixelFormat &format);
+
+// Layout of one frame of a stream in memory and of the texture it is uploaded into
+struct FrameFormat
+{
+    PixelFormat pixelFormat = PixelFormat::RGBA8;
+    uint32_t width = 0;
+    uint32_t height = 0;
+
+    // bytes of one row of uploadWidth() texels and of the whole frame
+    size_t rowBytes() const;
+    size_t frameBytes() const { return rowBytes() * uploadHeight(); }
+    // the same for frames as the producer writes them, before staging converts them
+    size_t sourceRowBytes() const;
+    size_t sourceFrameBytes() const { return sourceRowBytes() * uploadHeight(); }
+
+    // texture storage and glTexSubImage2D arguments
+    GLenum internalFormat() const;
+    GLenum glFormat() const;
+    GLenum glType() const;
+    uint32_t texelBytes() const;
+    // texture size in texels
+    uint32_t uploadWidth() const;
+    uint32_t uploadHeight() const;
+    // GL_TEXTURE_SWIZZLE_RGBA to apply to the texture, null to keep the default
+    const GLint *swizzle() const;
+};
+
+#endif // PIXELFORMAT_H
@@ -0,0 +1,220 @@
+#include "ProgramCache.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+
+#include "SDL2/SDL_timer.h"
+
+namespace {
+const uint32_t binaryMagic = 0x42505953; // "SYPB"
+
+struct BinaryHeader
+{
+    uint32_t magic = binaryMagic;
+    uint32_t format = 0;
+    uint32_t length = 0;
+};
+
+uint64_t fnv1a(uint64_t hash, const void *data, size_t size)
+{
+    const auto *bytes = static_cast<const uint8_t *>(data);
+    for (size_t i = 0; i < size; ++i) {
+        hash = (hash ^ bytes[i]) * 0x100000001b3ull;
+    }
+    return hash;
+}
+
+std::string glString(GLenum name)
+{
+    const auto *value = reinterpret_cast<const char *>(glGetString(name));
+    return value ? value : "";
+}
+
+double elapsedMs(uint64_t start)
+{
+    return static_cast<double>(SDL_GetPerformanceCounter() - start) * 1000.0
+           / SDL_GetPerformanceFrequency();
+}
+} // namespace
+
+GLuint compileProgram(const char *name, const std::vector<ShaderSource> &stages,
+                      bool retrievable)
+{
+    GLuint program = glCreateProgram();
+    std::vector<GLuint> shaders;
+    for (const auto &stage : stages) {
+        GLuint shader = glCreateShader(stage.type);
+        const char *source = stage.source.c_str();
+        glShaderSource(shader, 1, &source, nullptr);
+        glCompileShader(shader);
+
+        GLint success = 0;
+        glGetShaderiv(shader, GL_COMPILE_STATUS, &success);
+        if (!success) {
+            char log[1024] = {};
+            glGetShaderInfoLog(shader, sizeof(log), nullptr, log);
+            printf("%s: shader compile failed\n%s\n", name, log);
+            exit(1);
+        }
+        glAttachShader(program, shader);
+        shaders.push_back(shader);
+    }
+
+    if (retrievable) {
+        glProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+    }
+    glLinkProgram(program);
+    GLint success = 0;
+    glGetProgramiv(program, GL_LINK_STATUS, &success);
+    if (!success) {
+        char log[1024] = {};
+        glGetProgramInfoLog(program, sizeof(log), nullptr, log);
+        printf("%s: shader program link failed\n%s\n", name, log);
+        exit(1);
+    }
+
+    for (const GLuint shader : shaders) {
+        glDetachShader(program, shader);
+        glDeleteShader(shader);
+    }
+    return program;
+}
+
+ProgramCache::ProgramCache(std::string directory) : mDirectory(std::move(directory))
+{
+    if (mDirectory.empty()) {
+        return;
+    }
+    GLint formats = 0;
+    if (GLAD_GL_VERSION_4_1) {
+        glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+    }
+    std::error_code error;
+    std::filesystem::create_directories(mDirectory, error);
+    if (!formats || error) {
+        printf("Shader binary cache disabled: %s\n",
+               formats ? error.message().c_str() : "no program binary formats");
+        mDirectory.clear();
+        return;
+    }
+    // a driver update invalidates every binary
+    mDriver = glString(GL_VENDOR) + "|" + glString(GL_RENDERER) + "|" + glString(GL_VERSION);
+}
+
+GLuint ProgramCache::build(const char *name, const std::vector<ShaderSource> &stages)
+{
+    const uint64_t start = SDL_GetPerformanceCounter();
+    if (mDirectory.empty()) {
+        GLuint program = compileProgram(name, stages);
+        mCold.add(elapsedMs(start));
+        return program;
+    }
+
+    uint64_t hash = fnv1a(0xcbf29ce484222325ull, mDriver.data(), mDriver.size());
+    for (const auto &stage : stages) {
+        hash = fnv1a(hash, &stage.type, sizeof(stage.type));
+        hash = fnv1a(hash, stage.source.data(), stage.source.size());
+    }
+    char fileName[64];
+    snprintf(fileName, sizeof(fileName), "-%016llx.bin", static_cast<unsigned long long>(hash));
+    const std::string path = mDirectory + "/" + name + fileName;
+
+    if (GLuint program = load(path)) {
+        const double ms = elapsedMs(start);
+        mWarm.add(ms);
+        mHits++;
+        printf("%s: shader program loaded from binary cache in %.3f ms\n", name, ms);
+        return program;
+    }
+
+    GLuint program = compileProgram(name, stages, true);
+    store(path, program);
+    const double ms = elapsedMs(start);
+    mCold.add(ms);
+    mMisses++;
+    printf("%s: shader program compiled in %.3f ms\n", name, ms);
+    return program;
+}
+
+GLuint ProgramCache::load(const std::string &path)
+{
+    std::ifstream file(path, std::ios::binary | std::ios::ate);
+    if (!file) {
+        return 0;
+    }
+    const auto fileSize = static_cast<uint64_t>(file.tellg());
+    file.seekg(0);
+    BinaryHeader header;
+    file.read(reinterpret_cast<char *>(&header), sizeof(header));
+    // the length is only trusted once the magic matches and the file holds that many bytes
+    if (!file || header.magic != binaryMagic || !header.length
+        || header.length > fileSize - sizeof(header)) {
+        mRejected++;
+        return 0;
+    }
+    std::vector<char> binary(header.length);
+    file.read(binary.data(), static_cast<std::streamsize>(binary.size()));
+    if (!file) {
+        mRejected++;
+        return 0;
+    }
+
+    GLuint program = glCreateProgram();
+    glProgramBinary(program, header.format, binary.data(), static_cast<GLsizei>(binary.size()));
+    GLint success = 0;
+    glGetProgramiv(program, GL_LINK_STATUS, &success);
+    if (!success) {
+        // the driver may refuse binaries at any time, not only after an update
+        printf("Shader binary %s rejected by the driver, rebuilding\n", path.c_str());
+        glDeleteProgram(program);
+        mRejected++;
+        return 0;
+    }
+    return program;
+}
+
+void ProgramCache::store(const std::string &path, GLuint program)
+{
+    GLint length = 0;
+    glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+    if (length <= 0) {
+        return;
+    }
+    std::vector<char> binary(static_cast<size_t>(length));
+    GLenum format = 0;
+    glGetProgramBinary(program, length, &length, &format, binary.data());
+
+    BinaryHeader header;
+    header.format = format;
+    header.length = static_cast<uint32_t>(length);
+    // written next to the target and renamed, so a crash never leaves a truncated binary
+    const std::string tempPath = path + ".tmp";
+    {
+        std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+        file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+        file.write(binary.data(), length);
+        if (!file) {
+            printf("Failed to write shader binary %s\n", tempPath.c_str());
+            return;
+        }
+    }
+    std::error_code error;
+    std::filesystem::rename(tempPath, path, error);
+    if (error) {
+        printf("Failed to store shader binary %s: %s\n", path.c_str(), error.message().c_str());
+    }
+}
+
+void ProgramCache::printStats() const
+{
+    printf("Shader programs: %u from binary cache, %u compiled, %u binaries rejected\n", mHits,
+           mMisses, mRejected);
+    if (mWarm.count()) {
+        mWarm.print("warm");
+    }
+    if (mCold.count()) {
+        mCold.print("cold");
+    }
+}
@@ -0,0 +1,52 @@
+#ifndef PROGRAMCACHE_H
+#define PROGRAMCACHE_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "glad/gl.h"
+
+#include "TimingStats.h"
+
+struct ShaderSource
+{
+    GLenum type = 0;
+    std::string source;
+};
+
+// Builds GL programs and keeps their linked binaries on disk. Binaries are keyed by driver
+// vendor, renderer and version and by a hash of the sources, stored with glGetProgramBinary
+// and reloaded with glProgramBinary; a binary rejected by the driver is rebuilt from source.
+// Used on the main context only.
+class ProgramCache
+{
+public:
+    // empty directory disables the cache
+    explicit ProgramCache(std::string directory);
+
+    // exits on compile or link errors like the rest of the startup code
+    GLuint build(const char *name, const std::vector<ShaderSource> &stages);
+
+    void printStats() const;
+
+private:
+    GLuint load(const std::string &path);
+    void store(const std::string &path, GLuint program);
+
+    std::string mDirectory;
+    std::string mDriver;
+
+    uint32_t mHits = 0;
+    uint32_t mMisses = 0;
+    uint32_t mRejected = 0;
+    // time to get a usable program from a binary (warm) and from source (cold)
+    TimingStats mWarm;
+    TimingStats mCold;
+};
+
+// compiles and links without any cache, exits on errors
+GLuint compileProgram(const char *name, const std::vector<ShaderSource> &stages,
+                      bool retrievable = false);
+
+#endif // PROGRAMCACHE_H
@@ -0,0 +1,143 @@
+#include "RawFileSource.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string_view>
+
+#include "Frame.h"
+
+namespace {
+// frames per stream requested ahead of the one played
+const uint64_t readaheadFrames = 8;
+
+const std::string_view y4mMagic = "YUV4MPEG2 ";
+const std::string_view y4mFrame = "FRAME";
+// longer headers are not Y4M files this player can use
+const size_t y4mMaxHeader = 1024;
+} // namespace
+
+RawFileSource::RawFileSource(const std::string &path, const FrameFormat &rawFormat,
+                             uint32_t streams)
+    : mFile(path), mData(mFile.data()), mSize(mFile.size()), mFormat(rawFormat),
+      mStreams(streams)
+{
+    mY4m = mSize >= y4mMagic.size()
+           && std::memcmp(mData, y4mMagic.data(), y4mMagic.size()) == 0;
+    if (mY4m) {
+        mFirstFrame = parseY4mHeader();
+        // every FRAME line is assumed as long as the first one, checked when a frame is read
+        const uint8_t *line = mData + mFirstFrame;
+        const uint8_t *end = static_cast<const uint8_t *>(
+            std::memchr(line, '\n', std::min(mSize - mFirstFrame, y4mMaxHeader)));
+        if (!end || std::memcmp(line, y4mFrame.data(), y4mFrame.size()) != 0) {
+            printf("%s has no Y4M frames\n", path.c_str());
+            exit(1);
+        }
+        mFrameHeader = static_cast<size_t>(end - line) + 1;
+    }
+    mFrameStride = mFrameHeader + mFormat.sourceFrameBytes();
+    mFrameCount = (mSize - mFirstFrame) / mFrameStride;
+    if (!mFrameCount) {
+        printf("%s holds no complete %ux%u %s frame\n", path.c_str(), mFormat.width,
+               mFormat.height, pixelFormatName(mFormat.pixelFormat));
+        exit(1);
+    }
+    printf("Playing %s: %llu %ux%u %s frames\n", path.c_str(),
+           static_cast<unsigned long long>(mFrameCount), mFormat.width, mFormat.height,
+           pixelFormatName(mFormat.pixelFormat));
+    for (uint64_t i = 0; i < readaheadFrames; ++i) {
+        for (uint32_t stream = 0; stream < mStreams; ++stream) {
+            prefetch(i + stream * mFrameCount / mStreams);
+        }
+    }
+}
+
+bool RawFileSource::clipFrame(uint32_t stream, uint64_t frame, uint64_t &index) const
+{
+    index = (stream * mFrameCount / mStreams + frame) % mFrameCount;
+    return true;
+}
+
+const uint8_t *RawFileSource::frameData(uint32_t stream, uint64_t frame)
+{
+    uint64_t index = 0;
+    clipFrame(stream, frame, index);
+    // the window slides by one frame, only the frame entering it is new
+    prefetch(index + readaheadFrames);
+
+    const uint8_t *record = mData + mFirstFrame + index * mFrameStride;
+    if (mY4m && (std::memcmp(record, y4mFrame.data(), y4mFrame.size()) != 0
+                 || record[mFrameHeader - 1] != '\n')) {
+        printf("Y4M frame %llu has a FRAME line of another length, frame parameters are not "
+               "supported\n",
+               static_cast<unsigned long long>(index));
+        exit(1);
+    }
+    return record + mFrameHeader;
+}
+
+void RawFileSource::readFrame(uint32_t stream, uint64_t frame, uint8_t *dst, size_t pitch)
+{
+    const size_t rowBytes = mFormat.sourceRowBytes();
+    copyRows(dst, pitch, frameData(stream, frame), rowBytes, rowBytes, mFormat.uploadHeight());
+}
+
+size_t RawFileSource::parseY4mHeader()
+{
+    const uint8_t *end = static_cast<const uint8_t *>(
+        std::memchr(mData, '\n', std::min(mSize, y4mMaxHeader)));
+    if (!end) {
+        printf("Y4M header is not terminated\n");
+        exit(1);
+    }
+    const std::string_view header(reinterpret_cast<const char *>(mData),
+                                  static_cast<size_t>(end - mData));
+
+    std::string colorSpace = "420jpeg";
+    mFormat.width = 0;
+    mFormat.height = 0;
+    size_t pos = y4mMagic.size();
+    while (pos < header.size()) {
+        size_t next = header.find(' ', pos);
+        if (next == std::string_view::npos) {
+            next = header.size();
+        }
+        // parameters are a letter and a value, the ones not needed here are skipped
+        const std::string token(header.substr(pos, next - pos));
+        const std::string value = token.size() > 1 ? token.substr(1) : std::string();
+        const auto number = static_cast<uint32_t>(strtoul(value.c_str(), nullptr, 10));
+        if (!value.empty()) {
+            switch (token[0]) {
+            case 'W': mFormat.width = number; break;
+            case 'H': mFormat.height = number; break;
+            case 'C': colorSpace = value; break;
+            default: break;
+            }
+        }
+        pos = next + 1;
+    }
+
+    if (colorSpace == "mono") {
+        mFormat.pixelFormat = PixelFormat::R8;
+    } else if (colorSpace == "420jpeg" || colorSpace == "420mpeg2" || colorSpace == "420paldv"
+               || colorSpace == "420") {
+        mFormat.pixelFormat = PixelFormat::I420;
+    } else {
+        printf("Unsupported Y4M colour space %s, use mono or 420\n", colorSpace.c_str());
+        exit(1);
+    }
+    if (!mFormat.width || !mFormat.height
+        || (mFormat.pixelFormat == PixelFormat::I420
+            && (mFormat.width % 2 || mFormat.height % 2))) {
+        printf("Invalid Y4M frame size %ux%u\n", mFormat.width, mFormat.height);
+        exit(1);
+    }
+    return static_cast<size_t>(end - mData) + 1;
+}
+
+void RawFileSource::prefetch(uint64_t index)
+{
+    mFile.prefetch(mFirstFrame + index % mFrameCount * mFrameStride, mFrameStride);
+}
@@ -0,0 +1,51 @@
+#ifndef RAWFILESOURCE_H
+#define RAWFILESOURCE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include "FrameSource.h"
+#include "MappedFile.h"
+
+// Plays an uncompressed video file through a read-only memory mapping: either raw frames of a
+// given format back to back, or a YUV4MPEG2 (Y4M) stream in mono or 4:2:0, which declares its
+// own format. Frames go to staging straight from the mapping, the only copy is the one into
+// the upload arena. The pages of the next frames are prefetched so the copies do not wait for
+// the disk. The file loops, the streams play it shifted by an equal share of its length.
+class RawFileSource : public FrameSource
+{
+public:
+    // raw files hold frames of rawFormat as the producer writes them; exits on errors
+    RawFileSource(const std::string &path, const FrameFormat &rawFormat, uint32_t streams);
+
+    const char *name() const override { return mY4m ? "y4m" : "raw"; }
+    const FrameFormat &format() const override { return mFormat; }
+    uint64_t frameCount() const { return mFrameCount; }
+    bool clipFrame(uint32_t stream, uint64_t frame, uint64_t &index) const override;
+
+    const uint8_t *frameData(uint32_t stream, uint64_t frame) override;
+    void readFrame(uint32_t stream, uint64_t frame, uint8_t *dst, size_t pitch) override;
+
+private:
+    // parses the stream header, returns its size
+    size_t parseY4mHeader();
+    // asks the system to page in frame index of the file
+    void prefetch(uint64_t index);
+
+    MappedFile mFile;
+    const uint8_t *const mData;
+    const size_t mSize;
+
+    FrameFormat mFormat;
+    const uint32_t mStreams = 1;
+    bool mY4m = false;
+
+    // first frame record, distance between records and the FRAME line that starts a Y4M one
+    size_t mFirstFrame = 0;
+    size_t mFrameStride = 0;
+    size_t mFrameHeader = 0;
+    uint64_t mFrameCount = 0;
+};
+
+#endif // RAWFILESOURCE_H
@@ -0,0 +1,187 @@
+#include "RenderGraph.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <utility>
+
+#include "GlState.h"
+#include "ResourcePool.h"
+
+GLuint RenderGraph::Pass::texture(Resource resource) const
+{
+    const ResourceInfo &info = mGraph->mResources[resource];
+    if (info.physical < 0) {
+        printf("Render graph resource %s is not allocated\n", info.name.c_str());
+        exit(1);
+    }
+    return mGraph->mPool[info.physical].texture;
+}
+
+RenderGraph::RenderGraph(GlState &state, ResourcePool &pool)
+    : mState(state), mResourcePool(pool)
+{}
+
+RenderGraph::~RenderGraph()
+{
+    for (const auto &target : mPool) {
+        mState.deleteFramebuffer(target.framebuffer);
+        mResourcePool.releaseTexture(target.texture);
+    }
+}
+
+void RenderGraph::reset()
+{
+    mResources.clear();
+    mPasses.clear();
+}
+
+RenderGraph::Resource RenderGraph::backbuffer(int width, int height)
+{
+    ResourceInfo &info = mResources.emplace_back();
+    info.name = "backbuffer";
+    info.width = width;
+    info.height = height;
+    info.backbuffer = true;
+    return static_cast<Resource>(mResources.size() - 1);
+}
+
+RenderGraph::Resource RenderGraph::createTarget(const char *name, GLenum format, int width,
+                                                int height)
+{
+    ResourceInfo &info = mResources.emplace_back();
+    info.name = name;
+    info.format = format;
+    info.width = width;
+    info.height = height;
+    return static_cast<Resource>(mResources.size() - 1);
+}
+
+void RenderGraph::addPass(const char *name, std::vector<Resource> inputs, Resource output,
+                          std::function<void(const Pass &)> run)
+{
+    if (output >= mResources.size()) {
+        printf("Render pass %s writes an unknown resource\n", name);
+        exit(1);
+    }
+    for (const Resource input : inputs) {
+        if (input >= mResources.size() || input == output) {
+            printf("Render pass %s reads an invalid resource\n", name);
+            exit(1);
+        }
+    }
+    PassInfo &pass = mPasses.emplace_back();
+    pass.name = name;
+    pass.inputs = std::move(inputs);
+    pass.output = output;
+    pass.run = std::move(run);
+}
+
+void RenderGraph::execute()
+{
+    // walk back from the backbuffer: a pass lives if something live reads what it renders
+    std::vector<bool> needed(mResources.size());
+    std::vector<bool> live(mPasses.size());
+    for (size_t i = mPasses.size(); i-- > 0;) {
+        const PassInfo &pass = mPasses[i];
+        if (!mResources[pass.output].backbuffer && !needed[pass.output]) {
+            continue;
+        }
+        live[i] = true;
+        for (const Resource input : pass.inputs) {
+            needed[input] = true;
+        }
+    }
+
+    for (size_t i = 0; i < mPasses.size(); ++i) {
+        if (!live[i]) {
+            continue;
+        }
+        for (const Resource input : mPasses[i].inputs) {
+            mResources[input].lastUse = static_cast<int>(i);
+        }
+    }
+
+    mExecuted = 0;
+    mCulled = 0;
+    mTargets = 0;
+    for (size_t i = 0; i < mPasses.size(); ++i) {
+        const PassInfo &pass = mPasses[i];
+        if (!live[i]) {
+            mCulled++;
+            continue;
+        }
+        ResourceInfo &output = mResources[pass.output];
+        Pass context;
+        if (output.backbuffer) {
+            mState.bindFramebuffer(0);
+        } else {
+            if (output.physical < 0) {
+                output.physical = acquire(output);
+                mTargets++;
+            }
+            mState.bindFramebuffer(mPool[output.physical].framebuffer);
+            context.mOutput = mPool[output.physical].texture;
+        }
+        glViewport(0, 0, output.width, output.height);
+
+        context.mGraph = this;
+        context.mWidth = output.width;
+        context.mHeight = output.height;
+        pass.run(context);
+        mExecuted++;
+
+        // inputs read for the last time go back to the pool for the passes that follow
+        for (const Resource input : pass.inputs) {
+            ResourceInfo &info = mResources[input];
+            if (info.lastUse == static_cast<int>(i) && info.physical >= 0) {
+                mPool[info.physical].inUse = false;
+                info.physical = -1;
+            }
+        }
+    }
+
+    // targets nobody read still hold their texture
+    for (auto &info : mResources) {
+        if (info.physical >= 0) {
+            mPool[info.physical].inUse = false;
+            info.physical = -1;
+        }
+    }
+}
+
+int RenderGraph::acquire(const ResourceInfo &info)
+{
+    mAcquired++;
+    for (size_t i = 0; i < mPool.size(); ++i) {
+        PooledTarget &target = mPool[i];
+        if (!target.inUse && target.format == info.format && target.width == info.width
+            && target.height == info.height) {
+            target.inUse = true;
+            return static_cast<int>(i);
+        }
+    }
+
+    mCreated++;
+    PooledTarget &target = mPool.emplace_back();
+    target.format = info.format;
+    target.width = info.width;
+    target.height = info.height;
+    target.texture = mResourcePool.acquireTexture(mState, info.format, info.width, info.height);
+    target.framebuffer = mState.createFramebuffer(target.texture);
+    target.inUse = true;
+    return static_cast<int>(mPool.size() - 1);
+}
+
+void RenderGraph::printStats() const
+{
+    uint64_t bytes = 0;
+    for (const auto &target : mPool) {
+        bytes += static_cast<uint64_t>(target.width) * target.height
+                 * ResourcePool::formatBytes(target.format);
+    }
+    printf("Render graph: %u passes executed, %u culled, %u transient targets per frame\n",
+           mExecuted, mCulled, mTargets);
+    printf("  pool: %zu textures, %.1f MB, %llu of %llu acquisitions created a texture\n",
+           mPool.size(), bytes / (1024.0 * 1024.0), static_cast<unsigned long long>(mCreated),
+           static_cast<unsigned long long>(mAcquired));
+}
@@ -0,0 +1,114 @@
+#ifndef RENDERGRAPH_H
+#define RENDERGRAPH_H
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "glad/gl.h"
+
+class GlState;
+class ResourcePool;
+
+// Frame graph of render passes on the main context. Every frame the passes are declared with
+// the resources they read and the one they render into, then execute() culls passes whose
+// output never reaches the backbuffer and runs the rest in declaration order. Transient
+// textures are taken from a pool that persists across frames and are returned as soon as
+// their last reader ran, so targets whose lifetimes do not overlap share the same texture;
+// the pool grows with the peak number of live targets, not with the number of passes.
+class RenderGraph
+{
+public:
+    using Resource = uint32_t;
+
+    // what a pass callback sees
+    class Pass
+    {
+    public:
+        // texture of an input resource
+        GLuint texture(Resource resource) const;
+        // texture of the output, 0 for the backbuffer; compute passes write it as an image
+        GLuint output() const { return mOutput; }
+        int width() const { return mWidth; }
+        int height() const { return mHeight; }
+
+    private:
+        friend class RenderGraph;
+
+        const RenderGraph *mGraph = nullptr;
+        GLuint mOutput = 0;
+        int mWidth = 0;
+        int mHeight = 0;
+    };
+
+    // target textures come from pool, framebuffers are cached per texture
+    RenderGraph(GlState &state, ResourcePool &pool);
+    ~RenderGraph();
+
+    // forgets the passes and resources of the previous frame, keeps the pooled textures
+    void reset();
+
+    // default framebuffer of the window
+    Resource backbuffer(int width, int height);
+    // render target that only lives during this frame
+    Resource createTarget(const char *name, GLenum format, int width, int height);
+
+    // the framebuffer of output is bound and the viewport covers it when run is called
+    void addPass(const char *name, std::vector<Resource> inputs, Resource output,
+                 std::function<void(const Pass &)> run);
+
+    void execute();
+
+    void printStats() const;
+
+private:
+    struct ResourceInfo
+    {
+        std::string name;
+        GLenum format = 0;
+        int width = 0;
+        int height = 0;
+        bool backbuffer = false;
+        // index into mPool while allocated
+        int physical = -1;
+        // last live pass reading the resource
+        int lastUse = -1;
+    };
+
+    struct PassInfo
+    {
+        std::string name;
+        std::vector<Resource> inputs;
+        Resource output = 0;
+        std::function<void(const Pass &)> run;
+    };
+
+    struct PooledTarget
+    {
+        GLuint texture = 0;
+        GLuint framebuffer = 0;
+        GLenum format = 0;
+        int width = 0;
+        int height = 0;
+        bool inUse = false;
+    };
+
+    int acquire(const ResourceInfo &info);
+
+    GlState &mState;
+    ResourcePool &mResourcePool;
+    std::vector<ResourceInfo> mResources;
+    std::vector<PassInfo> mPasses;
+    std::vector<PooledTarget> mPool;
+
+    // last executed frame
+    uint32_t mExecuted = 0;
+    uint32_t mCulled = 0;
+    uint32_t mTargets = 0;
+    // targets acquired over all frames and how many of them needed a new texture
+    uint64_t mAcquired = 0;
+    uint64_t mCreated = 0;
+};
+
+#endif // RENDERGRAPH_H
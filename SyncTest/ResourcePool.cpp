@@ -0,0 +1,165 @@
+#include "ResourcePool.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+
+#include "GlState.h"
+
+ResourcePool::~ResourcePool()
+{
+    // objects cannot be deleted here, the context may already be gone
+    const size_t inUse = std::count_if(mEntries.begin(), mEntries.end(),
+                                       [](const Entry &entry) { return entry.inUse; });
+    if (inUse) {
+        printf("Resource pool destroyed with %zu objects in use\n", inUse);
+    }
+}
+
+uint32_t ResourcePool::formatBytes(GLenum format)
+{
+    switch (format) {
+    case GL_R8: return 1;
+    case GL_RG8: return 2;
+    // drivers pad three-byte texels to four
+    case GL_RGB8:
+    case GL_RGBA8:
+    case GL_RGB10_A2:
+    case GL_R32UI: return 4;
+    case GL_RGBA16F: return 8;
+    case GL_RGBA32F:
+    case GL_RGBA32UI: return 16;
+    default:
+        printf("Unknown texture format 0x%04x\n", format);
+        exit(1);
+    }
+}
+
+GLuint ResourcePool::acquireTexture(GlState &state, GLenum format, GLsizei width,
+                                    GLsizei height)
+{
+    std::lock_guard guard(mMutex);
+    for (auto &entry : mEntries) {
+        if (entry.texture && !entry.inUse && entry.format == format && entry.width == width
+            && entry.height == height) {
+            entry.inUse = true;
+            mReused++;
+            return entry.name;
+        }
+    }
+
+    Entry &entry = mEntries.emplace_back();
+    entry.texture = true;
+    entry.name = state.createTexture(format, width, height);
+    entry.format = format;
+    entry.width = width;
+    entry.height = height;
+    entry.bytes = static_cast<uint64_t>(width) * height * formatBytes(format);
+    entry.inUse = true;
+    mCreated++;
+    mPeakBytes = std::max(mPeakBytes, sumBytes());
+    return entry.name;
+}
+
+GLuint ResourcePool::acquireBuffer(GlState &state, GLenum target, GLsizeiptr size,
+                                   GLbitfield flags)
+{
+    std::lock_guard guard(mMutex);
+    for (auto &entry : mEntries) {
+        if (!entry.texture && !entry.inUse && entry.bytes == static_cast<uint64_t>(size)
+            && entry.flags == flags) {
+            entry.inUse = true;
+            mReused++;
+            return entry.name;
+        }
+    }
+
+    Entry &entry = mEntries.emplace_back();
+    entry.name = state.createBuffer(target, size, nullptr, flags);
+    entry.flags = flags;
+    entry.bytes = static_cast<uint64_t>(size);
+    entry.inUse = true;
+    mCreated++;
+    mPeakBytes = std::max(mPeakBytes, sumBytes());
+    return entry.name;
+}
+
+void ResourcePool::releaseTexture(GLuint texture)
+{
+    release(true, texture);
+}
+
+void ResourcePool::releaseBuffer(GLuint buffer)
+{
+    release(false, buffer);
+}
+
+void ResourcePool::release(bool texture, GLuint name)
+{
+    std::lock_guard guard(mMutex);
+    for (auto &entry : mEntries) {
+        if (entry.texture == texture && entry.name == name && entry.inUse) {
+            entry.inUse = false;
+            return;
+        }
+    }
+    printf("Released %s %u does not belong to the pool\n", texture ? "texture" : "buffer",
+           name);
+    exit(1);
+}
+
+void ResourcePool::trim(GlState &state)
+{
+    std::lock_guard guard(mMutex);
+    for (const auto &entry : mEntries) {
+        if (entry.inUse) {
+            continue;
+        }
+        if (entry.texture) {
+            state.deleteTexture(entry.name);
+        } else {
+            state.deleteBuffer(entry.name);
+        }
+    }
+    mEntries.erase(std::remove_if(mEntries.begin(), mEntries.end(),
+                                  [](const Entry &entry) { return !entry.inUse; }),
+                   mEntries.end());
+}
+
+uint64_t ResourcePool::heldBytes() const
+{
+    std::lock_guard guard(mMutex);
+    return sumBytes();
+}
+
+uint64_t ResourcePool::sumBytes() const
+{
+    uint64_t bytes = 0;
+    for (const auto &entry : mEntries) {
+        bytes += entry.bytes;
+    }
+    return bytes;
+}
+
+void ResourcePool::printStats() const
+{
+    std::lock_guard guard(mMutex);
+    uint64_t textureBytes = 0;
+    uint64_t bufferBytes = 0;
+    uint64_t inUseBytes = 0;
+    size_t textures = 0;
+    for (const auto &entry : mEntries) {
+        (entry.texture ? textureBytes : bufferBytes) += entry.bytes;
+        textures += entry.texture;
+        if (entry.inUse) {
+            inUseBytes += entry.bytes;
+        }
+    }
+    const double mb = 1024.0 * 1024.0;
+    printf("Resource pool: %zu textures %.1f MB, %zu buffers %.1f MB, %.1f MB in use, "
+           "peak %.1f MB\n",
+           textures, textureBytes / mb, mEntries.size() - textures, bufferBytes / mb,
+           inUseBytes / mb, mPeakBytes / mb);
+    printf("  %llu objects created, %llu requests served by recycling\n",
+           static_cast<unsigned long long>(mCreated), static_cast<unsigned long long>(mReused));
+}
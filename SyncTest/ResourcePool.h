@@ -0,0 +1,63 @@
+#ifndef RESOURCEPOOL_H
+#define RESOURCEPOOL_H
+
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+#include "glad/gl.h"
+
+class GlState;
+
+// Textures and buffers with immutable storage, recycled instead of deleted. Textures are keyed
+// by internal format and size, buffers by size and storage flags; a released object is handed
+// out again to the next request with the same key, so streams starting and stopping do not
+// make the driver allocate or free video memory. Objects are shared by the contexts of the
+// share group; whoever releases one has to make sure the GPU is done with it. GL calls go
+// through the state of the calling context.
+class ResourcePool
+{
+public:
+    ResourcePool() = default;
+    ~ResourcePool();
+
+    GLuint acquireTexture(GlState &state, GLenum format, GLsizei width, GLsizei height);
+    // target is only used to bind the buffer on contexts without direct state access
+    GLuint acquireBuffer(GlState &state, GLenum target, GLsizeiptr size, GLbitfield flags);
+    void releaseTexture(GLuint texture);
+    void releaseBuffer(GLuint buffer);
+
+    // deletes every object not in use
+    void trim(GlState &state);
+
+    uint64_t heldBytes() const;
+    void printStats() const;
+
+    // bytes per pixel of a sized internal format
+    static uint32_t formatBytes(GLenum format);
+
+private:
+    struct Entry
+    {
+        bool texture = false;
+        GLuint name = 0;
+        GLenum format = 0;
+        GLsizei width = 0;
+        GLsizei height = 0;
+        GLbitfield flags = 0;
+        uint64_t bytes = 0;
+        bool inUse = false;
+    };
+
+    void release(bool texture, GLuint name);
+    // called with the mutex locked
+    uint64_t sumBytes() const;
+
+    mutable std::mutex mMutex;
+    std::vector<Entry> mEntries;
+    uint64_t mCreated = 0;
+    uint64_t mReused = 0;
+    uint64_t mPeakBytes = 0;
+};
+
+#endif // RESOURCEPOOL_H
@@ -1,129 +1,199 @@
 #include "Shader.h"
+#include "GlState.h"
+#include "ProgramCache.h"
+#include <cstdio>
 #include <string>
 #include <vector>
 
-Shader::Shader()
+Shader::Shader(ProgramCache &programCache, GlState &state, const FrameFormat &format,
+               bool textureArrays)
+    : mState(state)
 {
-    // compile VERTEX shader
-
+    // frames are stored top row first, the first texture row is drawn at the top
     std::string vertexShaderStr=
         "#version 330 core\n"
         "layout(location=0)in vec2 verts;\n"
         "out vec2 texturePos;\n"
         "void main(){\n"
         "  gl_Position=vec4(verts.x,verts.y,0,1);\n"
-        "  texturePos=(verts+vec2(1.0))/vec2(2.0);\n"
+        "  texturePos=vec2(verts.x+1.0,1.0-verts.y)/vec2(2.0);\n"
         "}";
 
-
-    mVertexShader = glCreateShader(GL_VERTEX_SHADER);
-    char* vertexShaderStrPtr=&vertexShaderStr[0];
-    glShaderSource(mVertexShader, 1, &vertexShaderStrPtr, nullptr);
-    glCompileShader(mVertexShader);
-
-    GLint success;
-    glGetShaderiv(mVertexShader,GL_COMPILE_STATUS,&success);
-    if(!success){
-        printf("compile vertex shader failed\n");
-        exit(1);
-    }
-
-    printf("vertex shader compiled successfully\n");
-
-
-    // compile FRAGMENT shader
+    // the fragment shaders sample through these macros, so every one also builds for layers of
+    // an array texture
+    const std::string texturePreamble =
+        "#define SAMPLER sampler2D\n"
+        "#define USAMPLER usampler2D\n"
+        "#define TEXTURE(pos) texture(tex, pos)\n"
+        "#define FETCH(pos) texelFetch(tex, pos, 0)\n";
+    const std::string arrayPreamble =
+        "#define SAMPLER sampler2DArray\n"
+        "#define USAMPLER usampler2DArray\n"
+        "uniform int layer;\n"
+        "#define TEXTURE(pos) texture(tex, vec3(pos, float(layer)))\n"
+        "#define FETCH(pos) texelFetch(tex, ivec3(pos, layer), 0)\n";
 
     std::string fragmentShaderStr=
         R"(
-            #version 330 core
             layout(location=0)out vec4 res;
-            uniform sampler2D tex;
+            uniform SAMPLER tex;
             in vec2 texturePos;
             void main() {
-                res = texture(tex, texturePos);
+                res = TEXTURE(texturePos);
             }
             )";
 
-    mFragmentShader = glCreateShader(GL_FRAGMENT_SHADER);
-    char* fragmentShaderStrPtr=&fragmentShaderStr[0];
-    glShaderSource(mFragmentShader, 1, &fragmentShaderStrPtr, nullptr);
-    glCompileShader(mFragmentShader);
-
-    glGetShaderiv(mFragmentShader,GL_COMPILE_STATUS,&success);
-    if(!success){
-        printf("Shader compile failed\n");
-        exit(1);
-    }
-
-    printf("fragment shader compiled successfully\n");
+    // bit-packed masks: the fragment picks its word with texelFetch and extracts its bit
+    std::string maskFragmentShaderStr=
+        R"(
+            layout(location=0)out vec4 res;
+            uniform USAMPLER tex;
+            uniform int maskWidth;
+            in vec2 texturePos;
+            void main() {
+                int x = min(int(texturePos.x * float(maskWidth)), maskWidth - 1);
+                int y = min(int(texturePos.y * float(textureSize(tex, 0).y)),
+                            textureSize(tex, 0).y - 1);
+                uint word = FETCH(ivec2(x >> 5, y)).r;
+                res = vec4(vec3(float((word >> uint(x & 31)) & 1u)), 1.0);
+            }
+            )";
 
-    mShaderProgram = glCreateProgram();
+    // half float HDR: Reinhard tone mapping keeps values above one apart on an SDR output
+    std::string hdrFragmentShaderStr=
+        R"(
+            layout(location=0)out vec4 res;
+            uniform SAMPLER tex;
+            in vec2 texturePos;
+            void main() {
+                vec4 color = TEXTURE(texturePos);
+                res = vec4(color.rgb / (vec3(1.0) + color.rgb), color.a);
+            }
+            )";
 
-    glAttachShader(mShaderProgram, mVertexShader);
-    glAttachShader(mShaderProgram, mFragmentShader);
+    // I420: the chroma planes follow the luma rows, each chroma row takes half a texture row
+    std::string i420FragmentShaderStr=
+        R"(
+            layout(location=0)out vec4 res;
+            uniform SAMPLER tex;
+            in vec2 texturePos;
+            void main() {
+                int width = textureSize(tex, 0).x;
+                int height = textureSize(tex, 0).y / 3 * 2;
+                int x = min(int(texturePos.x * float(width)), width - 1);
+                int y = min(int(texturePos.y * float(height)), height - 1);
+                int cb = width * height + y / 2 * (width / 2) + x / 2;
+                int cr = cb + (width / 2) * (height / 2);
+                float luma = FETCH(ivec2(x, y)).r;
+                float u = FETCH(ivec2(cb % width, cb / width)).r - 0.5;
+                float v = FETCH(ivec2(cr % width, cr / width)).r - 0.5;
+                // BT.601 full range, as in JPEG
+                res = vec4(luma + 1.402 * v, luma - 0.344136 * u - 0.714136 * v,
+                           luma + 1.772 * u, 1.0);
+            }
+            )";
 
-    glLinkProgram(mShaderProgram);
-    glGetProgramiv(mShaderProgram, GL_LINK_STATUS, &success);
-    if(!success){
-        printf("shader program link failed\n");
-        exit(1);
+    std::string programName = "texture";
+    const std::string *fragment = &fragmentShaderStr;
+    if (format.pixelFormat == PixelFormat::Mask1) {
+        programName = "mask1";
+        fragment = &maskFragmentShaderStr;
+    } else if (format.pixelFormat == PixelFormat::I420) {
+        programName = "i420";
+        fragment = &i420FragmentShaderStr;
+    } else if (format.pixelFormat == PixelFormat::RGBA16F) {
+        programName = "texture-hdr";
+        fragment = &hdrFragmentShaderStr;
     }
 
-    printf("shader program linked successfully\n");
-
-    mLocation = glGetUniformLocation(mShaderProgram, "tex");
-    if (mLocation == -1){
-        printf("tex location not found\n");
-//        exit(1);
+    // the sampler always reads unit 0 and the mask width is fixed, set once instead of every draw
+    const GLint maskWidth = static_cast<GLint>(format.width);
+    auto build = [&](const std::string &name, const std::string &preamble) {
+        const GLuint program = programCache.build(
+            name.c_str(), {{GL_VERTEX_SHADER, vertexShaderStr},
+                           {GL_FRAGMENT_SHADER, "#version 330 core\n" + preamble + *fragment}});
+        const GLint location = glGetUniformLocation(program, "tex");
+        if (location == -1) {
+            printf("tex location not found\n");
+        }
+        const GLint maskWidthLocation = glGetUniformLocation(program, "maskWidth");
+        if (mState.directStateAccess()) {
+            glProgramUniform1i(program, location, 0);
+            if (maskWidthLocation != -1) {
+                glProgramUniform1i(program, maskWidthLocation, maskWidth);
+            }
+        } else {
+            mState.useProgram(program);
+            glUniform1i(location, 0);
+            if (maskWidthLocation != -1) {
+                glUniform1i(maskWidthLocation, maskWidth);
+            }
+        }
+        return program;
+    };
+    mShaderProgram = build(programName, texturePreamble);
+    if (textureArrays) {
+        mArrayProgram = build(programName + "-array", arrayPreamble);
+        mLayerLocation = glGetUniformLocation(mArrayProgram, "layer");
     }
 
+    std::vector<float> verts = {-1, -1, 1, -1, -1, 1, 1, 1};
+    mVertsCount=4;
+    const GLsizeiptr vertsSize = static_cast<GLsizeiptr>(verts.size() * sizeof(float));
 
-    // Create VAO
-    glGenVertexArrays(1, &mVAO);
-
-    // bind VAO
-    glBindVertexArray(mVAO);
+    GLuint location=0;
 
-    // create VBO
-    glGenBuffers(1, &mVBO);
+    if (mState.directStateAccess()) {
+        glCreateVertexArrays(1, &mVAO);
+        mVBO = mState.createBuffer(GL_ARRAY_BUFFER, vertsSize, verts.data(), 0);
 
-    // bind VBO
-    glBindBuffer(GL_ARRAY_BUFFER, mVBO);
+        glVertexArrayVertexBuffer(mVAO, 0, mVBO, 0, 2 * sizeof(float));
+        glEnableVertexArrayAttrib(mVAO, location);
+        glVertexArrayAttribFormat(mVAO, location, 2, GL_FLOAT, GL_FALSE, 0);
+        glVertexArrayAttribBinding(mVAO, location, 0);
+    } else {
+        // Create VAO
+        glGenVertexArrays(1, &mVAO);
 
-    std::vector<float> verts = {-1, -1, 1, -1, -1, 1, 1, 1};
-    mVertsCount=4;
+        // bind VAO
+        mState.bindVertexArray(mVAO);
 
-    glBufferData(GL_ARRAY_BUFFER, static_cast<GLsizeiptr>(verts.size() * sizeof(float) * 2),
-                 &verts[0], GL_STATIC_DRAW);
+        // create VBO
+        glGenBuffers(1, &mVBO);
 
-    GLuint location=0;
+        // bind VBO
+        mState.bindBuffer(GL_ARRAY_BUFFER, mVBO);
 
-    glEnableVertexAttribArray(location);
-    glVertexAttribPointer(location, 2, GL_FLOAT, GL_FALSE, 0, reinterpret_cast<void *>(0));
+        glBufferData(GL_ARRAY_BUFFER, vertsSize, verts.data(), GL_STATIC_DRAW);
 
-    glBindVertexArray(0);
+        glEnableVertexAttribArray(location);
+        glVertexAttribPointer(location, 2, GL_FLOAT, GL_FALSE, 0, reinterpret_cast<void *>(0));
+    }
 }
 
 Shader::~Shader()
 {
     glDeleteProgram(mShaderProgram);
-    glDeleteShader(mVertexShader);
-    glDeleteShader(mFragmentShader);
+    if (mArrayProgram) {
+        glDeleteProgram(mArrayProgram);
+    }
+    mState.deleteBuffer(mVBO);
+    glDeleteVertexArrays(1, &mVAO);
+    mState.invalidate();
 }
 
-void Shader::render(GLuint textureId)
+void Shader::render(GLuint textureId, GLint layer)
 {
-    glBindVertexArray(mVAO);
-    glUseProgram(mShaderProgram);
-
-    glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_2D, textureId);
-    glUniform1i(mLocation, 0);
+    // nothing is unbound afterwards, the state cache skips the binds of the next draw
+    mState.bindVertexArray(mVAO);
+    if (layer < 0) {
+        mState.useProgram(mShaderProgram);
+        mState.bindTexture(0, textureId);
+    } else {
+        mState.useProgram(mArrayProgram);
+        mState.bindTexture(0, textureId, GL_TEXTURE_2D_ARRAY);
+        glUniform1i(mLayerLocation, layer);
+    }
 
     glDrawArrays(GL_TRIANGLE_STRIP, 0, mVertsCount);
-
-    glBindTexture(GL_TEXTURE_2D, 0);
-
-    glUseProgram(0);
-    glBindVertexArray(0);
 }
@@ -3,21 +3,30 @@
 
 #include "glad/gl.h"
 
+#include "PixelFormat.h"
+
+class GlState;
+class ProgramCache;
+
 class Shader
 {
 public:
-    Shader();
+    // draws textures uploaded in format, expanding bit-packed masks, converting I420 and tone
+    // mapping HDR; textureArrays also builds the programs for layers of array textures
+    Shader(ProgramCache &programCache, GlState &state, const FrameFormat &format,
+           bool textureArrays);
     ~Shader();
 
-    void render(GLuint textureId);
+    // layer of a GL_TEXTURE_2D_ARRAY, -1 for a GL_TEXTURE_2D
+    void render(GLuint textureId, GLint layer = -1);
 
 private:
-    GLuint mVertexShader=0;
-    GLuint mFragmentShader=0;
+    GlState &mState;
 
     GLuint mShaderProgram=0;
 
-    GLint mLocation=-1;
+    GLuint mArrayProgram=0;
+    GLint mLayerLocation=-1;
 
     GLuint mVAO=0;    // Vertex Array Object
     GLuint mVBO=0;    // Vertex Buffer Object
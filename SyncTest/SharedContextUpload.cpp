@@ -0,0 +1,216 @@
+#include "SharedContextUpload.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <chrono>
+#include <cstring>
+#include <memory>
+
+#include "Frame.h"
+#include "GlState.h"
+#include "GpuTimer.h"
+#include "ResourcePool.h"
+
+namespace {
+// how often the upload thread polls upload fences while waiting for a free slot
+const std::chrono::microseconds monitorPollInterval(500);
+} // namespace
+
+SharedContextUpload::SharedContextUpload(const Options &options, FrameSource &source)
+    : UploadPipeline(options.streams, source)
+{
+    mStagingFrames = options.stagingBuffers;
+}
+
+SharedContextUpload::~SharedContextUpload()
+{
+    if (mThread.joinable()) {
+        mFinished = true;
+        mCond.notify_all();
+        mThread.join();
+    }
+
+    // the render thread destroys the pipeline with the main context current, the next
+    // pipeline may get the objects on another context
+    glFinish();
+    if (mArena) {
+        mArena->destroy();
+    }
+    for (const auto &slot : mSlots) {
+        for (const GLuint texture : slot.textures) {
+            mPool->releaseTexture(texture);
+        }
+    }
+}
+
+void SharedContextUpload::allocate(GlState &state, ResourcePool &pool)
+{
+    mState = &state;
+    mPool = &pool;
+    printFootprint(mStagingFrames);
+    mSlots.resize(texturesCount);
+    for (auto &slot : mSlots) {
+        for (uint32_t i = 0; i < mStreams; ++i) {
+            slot.textures.push_back(acquireTexture(state, pool));
+        }
+    }
+    mArena = std::make_unique<UploadArena>(
+        state, pool, UploadArena::capacityFor(stagedFrameBytes(), mStreams * mStagingFrames));
+    // nothing stays bound to the objects once the startup thread releases the context
+    state.bindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    state.bindTexture(0, 0);
+    // object creation has to be complete before the render context can use the textures
+    glFinish();
+}
+
+void SharedContextUpload::start(const GlContexts &contexts)
+{
+    mContexts = contexts;
+    mThread = std::thread([this]() { run(); });
+}
+
+const std::vector<GLuint> &SharedContextUpload::acquireFrame()
+{
+    {
+        std::unique_lock lock(mMutex);
+        while (mWriteIndex == mReadIndex) {
+            mCond.wait(lock);
+        }
+    }
+
+    const FrameSlot &readSlot = mSlots[mReadIndex];
+    for (const GLuint texture : readSlot.textures) {
+        mHandoff.acquire(mContexts.main, texture);
+    }
+    return readSlot.textures;
+}
+
+void SharedContextUpload::releaseFrame()
+{
+    std::lock_guard guard(mMutex);
+    mReadIndex = (mReadIndex + 1) % texturesCount;
+    mCond.notify_all();
+}
+
+UploadTimings SharedContextUpload::timings() const
+{
+    std::lock_guard guard(mMutex);
+    return mTimings;
+}
+
+void SharedContextUpload::printStats() const
+{
+    mHandoff.printStats();
+    mMonitor.printStats();
+    std::lock_guard guard(mMutex);
+    mArenaStats.print("upload");
+}
+
+void SharedContextUpload::run()
+{
+    SDL_GL_MakeCurrent(mContexts.window, mContexts.parallel);
+    GlState &state = *mState;
+    // another thread used the context since the state was last touched
+    state.invalidate();
+    setUnpackLayout(state);
+
+    std::vector<std::unique_ptr<uint8_t[]>> data;
+    for (uint32_t i = 0; i < mStreams; ++i) {
+        data.push_back(std::make_unique<uint8_t[]>(mFormat.sourceFrameBytes()));
+    }
+    const double ticksPerMs = SDL_GetPerformanceFrequency() / 1000.0;
+    GpuTimer uploadTimer;
+    // frames that need no conversion and are not in memory are read straight into the arena
+    const bool direct = mFormat.sourceRowBytes() == mFormat.rowBytes();
+    std::vector<const uint8_t *> frames(mStreams);
+    for (uint64_t frame = 0; !mFinished; ++frame) {
+        const uint64_t generateStart = SDL_GetPerformanceCounter();
+        for (uint32_t i = 0; i < mStreams; ++i) {
+            if (auto prepared = takePreparedFrame(i)) {
+                data[i] = std::move(prepared);
+                frames[i] = data[i].get();
+            } else if (const uint8_t *memory = mSource.frameData(i, frame)) {
+                frames[i] = memory;
+            } else if (direct) {
+                frames[i] = nullptr;
+            } else {
+                mSource.readFrame(i, frame, data[i].get(), mFormat.sourceRowBytes());
+                frames[i] = data[i].get();
+            }
+        }
+        uint64_t cpuTicks = SDL_GetPerformanceCounter() - generateStart;
+
+        {
+            // the wait for a free slot is idle time, spend it watching the GPU
+            std::unique_lock lock(mMutex);
+            while (!mFinished && mWriteIndex != mReadIndex) {
+                lock.unlock();
+                mMonitor.poll();
+                lock.lock();
+                if (!mFinished && mWriteIndex != mReadIndex) {
+                    mCond.wait_for(lock, monitorPollInterval);
+                }
+            }
+        }
+        if (mFinished) {
+            break;
+        }
+
+        FrameSlot &writeSlot = mSlots[mWriteIndex];
+        const uint64_t uploadStart = SDL_GetPerformanceCounter();
+        uploadTimer.begin();
+        for (uint32_t i = 0; i < mStreams; ++i) {
+            const GLuint texture = writeSlot.textures[i];
+
+            // waits here while the copies of older frames still read the space
+            UploadArena::Allocation allocation;
+            mArena->allocate(stagedFrameBytes(), allocation);
+            uint8_t *staged = mArena->map(allocation);
+            if (frames[i]) {
+                stageFrame(staged, frames[i]);
+            } else {
+                mSource.readFrame(i, frame, staged, framePitch());
+            }
+            mArena->unmap(allocation);
+
+            // binds stay in place between frames, the cache skips them when unchanged
+            state.bindBuffer(GL_PIXEL_UNPACK_BUFFER, mArena->buffer());
+            uploadFrame(state, texture, allocation.offset);
+
+            mHandoff.recordWrite(mContexts.parallel, texture);
+        }
+        uploadTimer.end();
+        cpuTicks += SDL_GetPerformanceCounter() - uploadStart;
+        // all streams of the frame behind one fence, which also frees their arena space
+        if (const uint64_t batch = mHandoff.submit(mContexts.parallel)) {
+            mMonitor.track(mHandoff.retain(batch), uint64_t{mFormat.frameBytes()} * mStreams,
+                           [this, batch]() { mHandoff.release(batch); });
+            mArena->fence(mHandoff.retain(batch), [this, batch]() { mHandoff.release(batch); });
+        } else {
+            mArena->fence();
+        }
+
+        {
+            std::lock_guard guard(mMutex);
+            mWriteIndex = (mWriteIndex + 1) % texturesCount;
+            mTimings.cpu.add(cpuTicks / ticksPerMs);
+            mTimings.gpu = uploadTimer.stats();
+            mArenaStats = mArena->stats();
+            mCond.notify_all();
+        }
+    }
+    // fences still watched have to be released before the handoff manager goes away
+    glFinish();
+    mMonitor.poll();
+    mArena->destroy();
+    uploadTimer.collect();
+    {
+        std::lock_guard guard(mMutex);
+        mTimings.gpu = uploadTimer.stats();
+    }
+    uploadTimer.destroy();
+    state.bindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    state.bindTexture(0, 0);
+    // let the context be made current on another thread by the next pipeline
+    SDL_GL_MakeCurrent(mContexts.window, nullptr);
+}
@@ -0,0 +1,68 @@
+#ifndef SHAREDCONTEXTUPLOAD_H
+#define SHAREDCONTEXTUPLOAD_H
+
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "SDL2/SDL.h"
+
+#include "HandoffManager.h"
+#include "Options.h"
+#include "UploadArena.h"
+#include "UploadMonitor.h"
+#include "UploadPipeline.h"
+
+// Upload thread with its own shared context stages frames in an UploadArena and copies them
+// into the texture ring; the arena holds a few frames, much less than the ring, and reuses
+// space once the fence of its copies signalled. The textures are handed over to the render
+// context through HandoffManager, one glFenceSync on the upload context and one glWaitSync on
+// the render context per frame of all streams.
+class SharedContextUpload : public UploadPipeline
+{
+public:
+    SharedContextUpload(const Options &options, FrameSource &source);
+    ~SharedContextUpload() override;
+
+    const char *name() const override { return "shared"; }
+    UploadContext uploadContext() const override { return UploadContext::Parallel; }
+
+    void allocate(GlState &state, ResourcePool &pool) override;
+    void start(const GlContexts &contexts) override;
+
+    const std::vector<GLuint> &acquireFrame() override;
+    void releaseFrame() override;
+
+    UploadTimings timings() const override;
+    void printStats() const override;
+
+private:
+    void run();
+
+    GlContexts mContexts;
+    // state of the parallel context, used by the upload thread
+    GlState *mState = nullptr;
+    ResourcePool *mPool = nullptr;
+
+    mutable std::mutex mMutex;
+    std::condition_variable mCond;
+    std::atomic_bool mFinished = false;
+
+    HandoffManager mHandoff;
+    UploadMonitor mMonitor;
+    std::vector<FrameSlot> mSlots;
+    uint32_t mStagingFrames = 0;
+    // created on the parallel context, used by the upload thread
+    std::unique_ptr<UploadArena> mArena;
+    uint32_t mReadIndex = 0;
+    uint32_t mWriteIndex = 0;
+    UploadTimings mTimings;
+    UploadArena::Stats mArenaStats;
+
+    std::thread mThread;
+};
+
+#endif // SHAREDCONTEXTUPLOAD_H
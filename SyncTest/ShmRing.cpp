@@ -0,0 +1,195 @@
+#include "ShmRing.h"
+
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+
+#ifdef _WIN32
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace {
+size_t alignUp(size_t value, size_t alignment)
+{
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+#ifdef _WIN32
+std::string mappingName(const std::string &name)
+{
+    return "Local\\" + name;
+}
+#else
+std::string shmName(const std::string &name)
+{
+    return "/" + name;
+}
+#endif
+} // namespace
+
+ShmRing::ShmRing(const std::string &name, const FrameFormat &format, uint32_t slots)
+    : mName(name), mOwner(true), mFormat(format)
+{
+    const size_t stride = alignUp(shmSlotPayloadOffset + format.sourceFrameBytes(),
+                                  shmRingAlignment);
+    mSize = shmRingAlignment + stride * slots;
+#ifdef _WIN32
+    const auto size = static_cast<uint64_t>(mSize);
+    mMapping = CreateFileMappingA(INVALID_HANDLE_VALUE, nullptr, PAGE_READWRITE,
+                                  static_cast<DWORD>(size >> 32), static_cast<DWORD>(size),
+                                  mappingName(name).c_str());
+    void *data = mMapping ? MapViewOfFile(mMapping, FILE_MAP_ALL_ACCESS, 0, 0, 0) : nullptr;
+    if (!data) {
+        printf("Failed to create shared memory %s: error %lu\n", name.c_str(), GetLastError());
+        exit(1);
+    }
+#else
+    // a ring left behind by a writer that was killed is replaced
+    shm_unlink(shmName(name).c_str());
+    const int file = shm_open(shmName(name).c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+    if (file < 0 || ftruncate(file, static_cast<off_t>(mSize)) != 0) {
+        printf("Failed to create shared memory %s: %s\n", name.c_str(), strerror(errno));
+        exit(1);
+    }
+    void *data = mmap(nullptr, mSize, PROT_READ | PROT_WRITE, MAP_SHARED, file, 0);
+    close(file);
+    if (data == MAP_FAILED) {
+        printf("Failed to map shared memory %s: %s\n", name.c_str(), strerror(errno));
+        exit(1);
+    }
+#endif
+    mData = static_cast<uint8_t *>(data);
+    mHeader = new (mData) ShmRingHeader;
+    mHeader->version = shmRingVersion;
+    mHeader->pixelFormat = static_cast<uint32_t>(format.pixelFormat);
+    mHeader->width = format.width;
+    mHeader->height = format.height;
+    mHeader->slots = slots;
+    mHeader->slotStride = stride;
+    // a reader that opens the ring early sees no magic until the header is complete
+    std::atomic_thread_fence(std::memory_order_release);
+    std::memcpy(mHeader->magic, shmRingMagic, sizeof(shmRingMagic));
+}
+
+ShmRing::ShmRing(const std::string &name) : mName(name)
+{
+#ifdef _WIN32
+    mMapping = OpenFileMappingA(FILE_MAP_ALL_ACCESS, FALSE, mappingName(name).c_str());
+    void *data = mMapping ? MapViewOfFile(mMapping, FILE_MAP_ALL_ACCESS, 0, 0, 0) : nullptr;
+    MEMORY_BASIC_INFORMATION info = {};
+    if (!data || !VirtualQuery(data, &info, sizeof(info))) {
+        printf("No shared memory ring %s, start the writer first\n", name.c_str());
+        exit(1);
+    }
+    mSize = info.RegionSize;
+#else
+    const int file = shm_open(shmName(name).c_str(), O_RDWR, 0);
+    struct stat info = {};
+    if (file < 0 || fstat(file, &info) != 0) {
+        printf("No shared memory ring %s, start the writer first\n", name.c_str());
+        exit(1);
+    }
+    mSize = static_cast<size_t>(info.st_size);
+    void *data = mSize ? mmap(nullptr, mSize, PROT_READ | PROT_WRITE, MAP_SHARED, file, 0)
+                       : MAP_FAILED;
+    close(file);
+    if (data == MAP_FAILED) {
+        printf("Failed to map shared memory %s: %s\n", name.c_str(), strerror(errno));
+        exit(1);
+    }
+#endif
+    mData = static_cast<uint8_t *>(data);
+    mHeader = reinterpret_cast<ShmRingHeader *>(mData);
+    if (mSize < shmRingAlignment
+        || std::memcmp(mHeader->magic, shmRingMagic, sizeof(shmRingMagic)) != 0
+        || mHeader->version != shmRingVersion) {
+        printf("%s is not a version %u shared memory ring\n", name.c_str(), shmRingVersion);
+        exit(1);
+    }
+    std::atomic_thread_fence(std::memory_order_acquire);
+    mFormat.pixelFormat = static_cast<PixelFormat>(mHeader->pixelFormat);
+    mFormat.width = mHeader->width;
+    mFormat.height = mHeader->height;
+    if (std::strcmp(pixelFormatName(mFormat.pixelFormat), "unknown") == 0 || !mFormat.width
+        || !mFormat.height || !mHeader->slots
+        || mHeader->slotStride < shmSlotPayloadOffset + mFormat.sourceFrameBytes()
+        || (mSize - shmRingAlignment) / mHeader->slotStride < mHeader->slots) {
+        printf("Shared memory ring %s has an invalid header\n", name.c_str());
+        exit(1);
+    }
+}
+
+ShmRing::~ShmRing()
+{
+#ifdef _WIN32
+    UnmapViewOfFile(mData);
+    CloseHandle(mMapping);
+#else
+    munmap(mData, mSize);
+    // readers keep their mapping, the name goes with the writer
+    if (mOwner) {
+        shm_unlink(shmName(mName).c_str());
+    }
+#endif
+}
+
+uint8_t *ShmRing::writeSlot()
+{
+    const uint64_t written = mHeader->written.load(std::memory_order_relaxed);
+    if (written - mHeader->released.load(std::memory_order_acquire) >= mHeader->slots) {
+        return nullptr;
+    }
+    return slot(written) + shmSlotPayloadOffset;
+}
+
+void ShmRing::publish()
+{
+    const uint64_t written = mHeader->written.load(std::memory_order_relaxed);
+    auto *header = reinterpret_cast<ShmSlotHeader *>(slot(written));
+    header->sequence = written;
+    header->timestampNs = now();
+    mHeader->written.store(written + 1, std::memory_order_release);
+}
+
+uint64_t ShmRing::written() const
+{
+    return mHeader->written.load(std::memory_order_acquire);
+}
+
+uint64_t ShmRing::released() const
+{
+    return mHeader->released.load(std::memory_order_relaxed);
+}
+
+const uint8_t *ShmRing::frame(uint64_t index, ShmSlotHeader &slotHeader) const
+{
+    const uint8_t *data = slot(index);
+    std::memcpy(&slotHeader, data, sizeof(slotHeader));
+    return data + shmSlotPayloadOffset;
+}
+
+void ShmRing::release(uint64_t frames)
+{
+    mHeader->released.store(frames, std::memory_order_release);
+}
+
+int64_t ShmRing::now()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+}
+
+uint8_t *ShmRing::slot(uint64_t index) const
+{
+    return mData + shmRingAlignment + index % mHeader->slots * mHeader->slotStride;
+}
@@ -0,0 +1,100 @@
+#ifndef SHMRING_H
+#define SHMRING_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include "PixelFormat.h"
+
+// Frame ring in shared memory between one writer process and one reader process, POSIX
+// shm_open or a named file mapping on Windows. Layout:
+//   ShmRingHeader, padded to shmRingAlignment
+//   slots: a ShmSlotHeader padded to shmSlotPayloadOffset, then one frame as the producer
+//          writes it, sourceFrameBytes() with rows sourceRowBytes() apart
+// The writer fills the slot of frame written and then increments written, the reader reads
+// frames below written in place and moves released past the ones it is done with; the writer
+// waits while every slot is written and not released, so no frame is lost. Frame n is in slot
+// n % slots. The counters have cache lines of their own.
+
+const char shmRingMagic[4] = {'S', 'F', 'R', 'G'};
+const uint32_t shmRingVersion = 1;
+// start of the slots and distance between them, a page
+const size_t shmRingAlignment = 4096;
+// start of the frame in a slot
+const size_t shmSlotPayloadOffset = 64;
+
+static_assert(std::atomic<uint64_t>::is_always_lock_free,
+              "the ring counters are shared between processes");
+
+struct ShmRingHeader
+{
+    char magic[4] = {};
+    uint32_t version = 0;
+    uint32_t pixelFormat = 0;
+    uint32_t width = 0;
+    uint32_t height = 0;
+    uint32_t slots = 0;
+    uint64_t slotStride = 0;
+
+    // frames published, written by the writer only
+    alignas(64) std::atomic<uint64_t> written{0};
+    // frames the reader is done with, written by the reader only
+    alignas(64) std::atomic<uint64_t> released{0};
+};
+
+struct ShmSlotHeader
+{
+    // number of the frame in the ring
+    uint64_t sequence = 0;
+    // ShmRing::now() when the writer published the frame
+    int64_t timestampNs = 0;
+};
+
+class ShmRing
+{
+public:
+    // creates the ring as the writer, replacing a stale one of the same name; exits on errors
+    ShmRing(const std::string &name, const FrameFormat &format, uint32_t slots);
+    // opens the ring of a running writer as the reader, exits if there is none
+    explicit ShmRing(const std::string &name);
+    ~ShmRing();
+
+    ShmRing(const ShmRing &) = delete;
+    ShmRing &operator=(const ShmRing &) = delete;
+
+    const FrameFormat &format() const { return mFormat; }
+    uint32_t slots() const { return mHeader->slots; }
+
+    // writer: slot for the next frame, null if the reader holds all of them
+    uint8_t *writeSlot();
+    // writer: makes the frame in writeSlot() visible to the reader
+    void publish();
+
+    // reader: frames published so far and frames handed back
+    uint64_t written() const;
+    uint64_t released() const;
+    // reader: frame index, which has to be below written() and not released
+    const uint8_t *frame(uint64_t index, ShmSlotHeader &slot) const;
+    // reader: hands the slots of the frames below frames back to the writer
+    void release(uint64_t frames);
+
+    // monotonic nanoseconds, the same clock in every process of the machine
+    static int64_t now();
+
+private:
+    uint8_t *slot(uint64_t index) const;
+
+    std::string mName;
+    bool mOwner = false;
+    FrameFormat mFormat;
+    uint8_t *mData = nullptr;
+    size_t mSize = 0;
+    ShmRingHeader *mHeader = nullptr;
+#ifdef _WIN32
+    void *mMapping = nullptr;
+#endif
+};
+
+#endif // SHMRING_H
@@ -0,0 +1,112 @@
+#include "ShmSource.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+
+#include "Frame.h"
+
+namespace {
+// a writer that has not published a first frame by then is not running
+const int64_t firstFrameTimeoutNs = 5000000000;
+// a writer slower than this repeats frames
+const int64_t underrunTimeoutNs = 100000000;
+// the writer is polled by yielding for this long, then by sleeping, which wakes up later
+const int64_t spinNs = 200000;
+const auto pollSleep = std::chrono::microseconds(100);
+
+double toMs(int64_t ns)
+{
+    return ns / 1e6;
+}
+} // namespace
+
+ShmSource::ShmSource(const std::string &name, uint32_t streams) : mName(name), mStreams(streams)
+{
+    for (uint32_t i = 0; i < streams; ++i) {
+        Stream &stream = mStreams[i];
+        stream.ring = std::make_unique<ShmRing>(ringName(name, i));
+        const FrameFormat &ringFormat = stream.ring->format();
+        if (!i) {
+            mFormat = ringFormat;
+        } else if (ringFormat.pixelFormat != mFormat.pixelFormat
+                   || ringFormat.width != mFormat.width || ringFormat.height != mFormat.height) {
+            printf("Shared memory ring %s holds other frames than %s\n",
+                   ringName(name, i).c_str(), ringName(name, 0).c_str());
+            exit(1);
+        }
+    }
+    printf("Receiving %ux%u %s frames from shared memory %s, %u slots per stream\n",
+           mFormat.width, mFormat.height, pixelFormatName(mFormat.pixelFormat), name.c_str(),
+           mStreams.front().ring->slots());
+}
+
+std::string ShmSource::ringName(const std::string &name, uint32_t stream)
+{
+    return name + "-" + std::to_string(stream);
+}
+
+const uint8_t *ShmSource::frameData(uint32_t streamIndex, uint64_t /*frame*/)
+{
+    Stream &stream = mStreams[streamIndex];
+    ShmRing &ring = *stream.ring;
+    const uint64_t next = stream.data ? stream.held + 1 : ring.released();
+    const int64_t waitStart = ShmRing::now();
+    const int64_t timeout = stream.data ? underrunTimeoutNs : firstFrameTimeoutNs;
+    int64_t now = waitStart;
+    while (ring.written() <= next) {
+        now = ShmRing::now();
+        if (now - waitStart >= timeout) {
+            if (!stream.data) {
+                printf("No frame in shared memory ring %s after %.0f s\n",
+                       ringName(mName, streamIndex).c_str(), toMs(timeout) / 1000);
+                exit(1);
+            }
+            stream.underruns++;
+            return stream.data;
+        }
+        if (now - waitStart < spinNs) {
+            std::this_thread::yield();
+        } else {
+            std::this_thread::sleep_for(pollSleep);
+        }
+    }
+
+    // the held frame stays readable until the next one is in hand
+    ShmSlotHeader slot;
+    stream.data = ring.frame(next, slot);
+    stream.held = next;
+    ring.release(next);
+    now = ShmRing::now();
+    stream.waits.add(toMs(now - waitStart));
+    stream.latency.add(toMs(now - slot.timestampNs));
+    if (!stream.frames) {
+        stream.firstNs = now;
+    }
+    stream.lastNs = now;
+    stream.frames++;
+    return stream.data;
+}
+
+void ShmSource::readFrame(uint32_t stream, uint64_t frame, uint8_t *dst, size_t pitch)
+{
+    const size_t rowBytes = mFormat.sourceRowBytes();
+    copyRows(dst, pitch, frameData(stream, frame), rowBytes, rowBytes, mFormat.uploadHeight());
+}
+
+void ShmSource::printStats() const
+{
+    for (uint32_t i = 0; i < mStreams.size(); ++i) {
+        const Stream &stream = mStreams[i];
+        const double seconds = (stream.lastNs - stream.firstNs) / 1e9;
+        printf("Shared memory stream %u: %llu frames, %.1f fps, %.1f MB/s, %llu underruns\n", i,
+               static_cast<unsigned long long>(stream.frames),
+               seconds > 0 ? (stream.frames - 1) / seconds : 0.0,
+               seconds > 0 ? (stream.frames - 1) * mFormat.sourceFrameBytes() / 1e6 / seconds
+                           : 0.0,
+               static_cast<unsigned long long>(stream.underruns));
+        stream.latency.print("latency");
+        stream.waits.print("writer wait");
+    }
+}
@@ -0,0 +1,56 @@
+#ifndef SHMSOURCE_H
+#define SHMSOURCE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "FrameSource.h"
+#include "ShmRing.h"
+#include "TimingStats.h"
+
+// Plays frames an external process writes into shared memory rings, one ring per stream named
+// ringName(name, stream); ShmWriter is a reference writer. Frames go to staging straight from
+// the ring, the only copy is the one into the upload arena. Every request takes the next frame
+// the writer published and hands the previous one back; when the writer falls behind, the last
+// frame is repeated and counted as an underrun. The streams are live and do not loop.
+class ShmSource : public FrameSource
+{
+public:
+    // waits for the rings of a running writer, exits if there are none
+    ShmSource(const std::string &name, uint32_t streams);
+
+    const char *name() const override { return "shm"; }
+    const FrameFormat &format() const override { return mFormat; }
+    static std::string ringName(const std::string &name, uint32_t stream);
+
+    const uint8_t *frameData(uint32_t stream, uint64_t frame) override;
+    void readFrame(uint32_t stream, uint64_t frame, uint8_t *dst, size_t pitch) override;
+
+    void printStats() const override;
+
+private:
+    struct Stream
+    {
+        std::unique_ptr<ShmRing> ring;
+        // ring frame held for staging, valid once one was received
+        uint64_t held = 0;
+        const uint8_t *data = nullptr;
+
+        uint64_t frames = 0;
+        uint64_t underruns = 0;
+        int64_t firstNs = 0;
+        int64_t lastNs = 0;
+        // from publishing to receiving a frame, and waiting for the writer
+        TimingStats latency;
+        TimingStats waits;
+    };
+
+    const std::string mName;
+    FrameFormat mFormat;
+    std::vector<Stream> mStreams;
+};
+
+#endif // SHMSOURCE_H
@@ -0,0 +1,293 @@
+#include "SingleContextUpload.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include "SDL2/SDL_timer.h"
+
+#include "Frame.h"
+#include "GlState.h"
+#include "ResourcePool.h"
+
+SingleContextUpload::SingleContextUpload(const Options &options, FrameSource &source)
+    : UploadPipeline(options.streams, source)
+{
+    // the frame being drawn stays in the ring, the rest may be uploaded ahead
+    mUploadAhead = std::clamp<uint32_t>(options.uploadAhead, 1, texturesCount - 1);
+    if (mUploadAhead != options.uploadAhead) {
+        printf("Upload ahead clamped to %u frames\n", mUploadAhead);
+    }
+    mStaging.resize(options.stagingBuffers);
+}
+
+void SingleContextUpload::allocate(GlState &state, ResourcePool &pool)
+{
+    mState = &state;
+    mPool = &pool;
+    mArena = std::make_unique<UploadArena>(
+        state, pool, UploadArena::capacityFor(streamStride() * mStreams, mStaging.size()));
+    mArena->setRetireCallback([this](GLsync sync) { mMonitor.observed(sync); });
+    printf("Single context upload: %u frames ahead, %s\n", mUploadAhead,
+           mArena->persistent() ? "persistently mapped" : "mapped per staging frame");
+    printFootprint(static_cast<uint32_t>(mStaging.size()));
+
+    mFrames.resize(texturesCount);
+    for (auto &frame : mFrames) {
+        for (uint32_t i = 0; i < mStreams; ++i) {
+            frame.textures.push_back(acquireTexture(state, pool));
+        }
+    }
+    for (auto &staging : mStaging) {
+        reserve(staging, true);
+    }
+    mapForFill();
+    setUnpackLayout(state);
+}
+
+void SingleContextUpload::start(const GlContexts &)
+{
+    mThread = std::thread([this]() { run(); });
+}
+
+SingleContextUpload::~SingleContextUpload()
+{
+    if (mThread.joinable()) {
+        mFinished = true;
+        mCond.notify_all();
+        mThread.join();
+    }
+    mUploadTimer.destroy();
+    // the pool may hand the objects to a pipeline on another context
+    glFinish();
+
+    if (mArena) {
+        for (const Staging &staging : mStaging) {
+            if (!mArena->persistent() && !staging.mapped.empty()) {
+                mArena->unmap(staging.region);
+            }
+        }
+        mArena->destroy();
+    }
+    for (const auto &frame : mFrames) {
+        for (const GLuint texture : frame.textures) {
+            mPool->releaseTexture(texture);
+        }
+    }
+    if (mState) {
+        mState->bindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    }
+}
+
+const std::vector<GLuint> &SingleContextUpload::acquireFrame()
+{
+    mMonitor.poll();
+    retire(false);
+
+    std::unique_lock lock(mMutex);
+    while (!mReadyFrames) {
+        if (mStaging[mUploadIndex].state == StagingState::Filled) {
+            lock.unlock();
+            upload();
+            lock.lock();
+        } else if (mStaging[mRetireIndex].state == StagingState::Uploaded) {
+            // the fill thread may be waiting for exactly this staging buffer
+            lock.unlock();
+            retire(true);
+            lock.lock();
+        } else {
+            mCond.wait(lock);
+        }
+    }
+
+    // issue the copies for the next frames now so they overlap with this frame; ring textures
+    // may be overwritten right after their draw, the context orders the copy behind it
+    while (mReadyFrames <= mUploadAhead && mReadyFrames < texturesCount
+           && mStaging[mUploadIndex].state == StagingState::Filled) {
+        lock.unlock();
+        upload();
+        lock.lock();
+    }
+
+    return mFrames[mDrawFrame].textures;
+}
+
+void SingleContextUpload::releaseFrame()
+{
+    std::lock_guard guard(mMutex);
+    mDrawFrame = (mDrawFrame + 1) % texturesCount;
+    mReadyFrames--;
+}
+
+UploadTimings SingleContextUpload::timings() const
+{
+    UploadTimings result;
+    result.gpu = mUploadTimer.stats();
+    std::lock_guard guard(mMutex);
+    result.cpu = mFillStats;
+    return result;
+}
+
+void SingleContextUpload::printStats() const
+{
+    mMonitor.printStats();
+    mArena->stats().print("render");
+}
+
+void SingleContextUpload::upload()
+{
+    GlState &state = *mState;
+    Staging &staging = mStaging[mUploadIndex];
+    const FrameSlot &frame = mFrames[mWriteFrame];
+    if (!mArena->persistent()) {
+        // the filled frame is the one mapped, copies cannot read a mapped buffer
+        mArena->unmap(staging.region);
+        std::lock_guard guard(mMutex);
+        staging.mapped.clear();
+        mFillMapped = false;
+    }
+    mUploadTimer.begin();
+    // the unpack buffer stays bound, client-memory uploads on this context must unbind it
+    state.bindBuffer(GL_PIXEL_UNPACK_BUFFER, mArena->buffer());
+    for (uint32_t i = 0; i < mStreams; ++i) {
+        uploadFrame(state, frame.textures[i], staging.region.offset + i * streamStride());
+    }
+
+    mUploadTimer.end();
+
+    // same context: draws are ordered after the copies, the fence only guards the arena; the
+    // frames filled after this one are not covered by it
+    mMonitor.track(mArena->fence(staging.region), uint64_t{mFormat.frameBytes()} * mStreams);
+
+    {
+        std::lock_guard guard(mMutex);
+        staging.state = StagingState::Uploaded;
+        mUploadIndex = (mUploadIndex + 1) % mStaging.size();
+        mWriteFrame = (mWriteFrame + 1) % texturesCount;
+        mReadyFrames++;
+    }
+    mapForFill();
+}
+
+void SingleContextUpload::retire(bool block)
+{
+    while (true) {
+        Staging &staging = mStaging[mRetireIndex];
+        {
+            std::lock_guard guard(mMutex);
+            if (staging.state != StagingState::Uploaded) {
+                break;
+            }
+        }
+        if (!reserve(staging, block)) {
+            break;
+        }
+
+        std::lock_guard guard(mMutex);
+        staging.state = StagingState::Free;
+        mRetireIndex = (mRetireIndex + 1) % mStaging.size();
+        mCond.notify_all();
+        block = false;
+    }
+    mapForFill();
+}
+
+bool SingleContextUpload::reserve(Staging &staging, bool block)
+{
+    // the arena is a FIFO sized for the staging frames, which are filled and uploaded in order:
+    // the space comes free exactly when the copies of the oldest uploaded frame completed
+    UploadArena::Allocation region;
+    if (!mArena->allocate(streamStride() * mStreams, region, block)) {
+        return false;
+    }
+    std::vector<uint8_t *> mapped;
+    if (mArena->persistent()) {
+        mapped = streamPointers(mArena->map(region));
+    }
+
+    std::lock_guard guard(mMutex);
+    staging.region = region;
+    staging.mapped = std::move(mapped);
+    return true;
+}
+
+void SingleContextUpload::mapForFill()
+{
+    if (mArena->persistent()) {
+        return;
+    }
+    Staging *staging = nullptr;
+    {
+        std::lock_guard guard(mMutex);
+        if (mFillMapped || mStaging[mFillIndex].state != StagingState::Free) {
+            return;
+        }
+        staging = &mStaging[mFillIndex];
+    }
+    // the fill thread waits for the pointers, its copies were fenced before the space was
+    // reserved again
+    std::vector<uint8_t *> mapped = streamPointers(mArena->map(staging->region));
+
+    std::lock_guard guard(mMutex);
+    staging->mapped = std::move(mapped);
+    mFillMapped = true;
+    mCond.notify_all();
+}
+
+std::vector<uint8_t *> SingleContextUpload::streamPointers(uint8_t *data) const
+{
+    std::vector<uint8_t *> pointers(mStreams);
+    for (uint32_t i = 0; i < mStreams; ++i) {
+        pointers[i] = data + i * streamStride();
+    }
+    return pointers;
+}
+
+void SingleContextUpload::run()
+{
+    const double ticksPerMs = SDL_GetPerformanceFrequency() / 1000.0;
+    std::vector<uint8_t> scratch;
+    for (uint64_t frame = 0; !mFinished; ++frame) {
+        std::vector<uint8_t *> mapped;
+        {
+            std::unique_lock lock(mMutex);
+            // without persistent mapping a free staging frame waits to be mapped as well
+            while (!mFinished
+                   && (mStaging[mFillIndex].state != StagingState::Free
+                       || mStaging[mFillIndex].mapped.empty())) {
+                mCond.wait(lock);
+            }
+            mapped = mStaging[mFillIndex].mapped;
+        }
+        if (mFinished) {
+            break;
+        }
+
+        // copied once from memory held by the source, otherwise written straight into the
+        // arena unless staging converts the frames
+        const uint64_t fillStart = SDL_GetPerformanceCounter();
+        const bool direct = mFormat.sourceRowBytes() == mFormat.rowBytes();
+        for (uint32_t i = 0; i < mStreams; ++i) {
+            if (auto prepared = takePreparedFrame(i)) {
+                stageFrame(mapped[i], prepared.get());
+            } else if (const uint8_t *data = mSource.frameData(i, frame)) {
+                stageFrame(mapped[i], data);
+            } else if (direct) {
+                mSource.readFrame(i, frame, mapped[i], framePitch());
+            } else {
+                scratch.resize(mFormat.sourceFrameBytes());
+                mSource.readFrame(i, frame, scratch.data(), mFormat.sourceRowBytes());
+                stageFrame(mapped[i], scratch.data());
+            }
+        }
+
+        {
+            std::lock_guard guard(mMutex);
+            mFillStats.add((SDL_GetPerformanceCounter() - fillStart) / ticksPerMs);
+            mStaging[mFillIndex].state = StagingState::Filled;
+            mFillIndex = (mFillIndex + 1) % mStaging.size();
+            mCond.notify_all();
+        }
+    }
+}
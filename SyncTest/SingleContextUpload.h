@@ -0,0 +1,103 @@
+#ifndef SINGLECONTEXTUPLOAD_H
+#define SINGLECONTEXTUPLOAD_H
+
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "GpuTimer.h"
+#include "Options.h"
+#include "UploadArena.h"
+#include "UploadMonitor.h"
+#include "UploadPipeline.h"
+
+// Fill thread only writes into a persistently mapped UploadArena; the render context copies
+// the frames into the texture ring itself, uploadAhead frames before drawing, so no
+// cross-context synchronization is needed. Before GL 4.4 the render context maps the staging
+// frame the fill thread fills next and unmaps it before its copies, one at a time, as a buffer
+// cannot be mapped twice or read by copies while mapped. The arena holds fewer frames than the
+// ring; arena fences on the render context tell when a staging frame may be refilled.
+class SingleContextUpload : public UploadPipeline
+{
+public:
+    SingleContextUpload(const Options &options, FrameSource &source);
+    ~SingleContextUpload() override;
+
+    const char *name() const override { return "single"; }
+    UploadContext uploadContext() const override { return UploadContext::Main; }
+
+    void allocate(GlState &state, ResourcePool &pool) override;
+    void start(const GlContexts &contexts) override;
+
+    const std::vector<GLuint> &acquireFrame() override;
+    void releaseFrame() override;
+
+    UploadTimings timings() const override;
+    void printStats() const override;
+
+private:
+    enum class StagingState {
+        Free,     // mapped, may be filled by the fill thread
+        Filled,   // filled, waiting for the render context to upload it
+        Uploaded, // copy into a ring texture issued, waiting for its fence
+    };
+
+    // arena space of one frame of every stream, one allocation with a fence of its own
+    struct Staging
+    {
+        UploadArena::Allocation region;
+        std::vector<uint8_t *> mapped;
+        StagingState state = StagingState::Free;
+    };
+
+    // bytes between the streams of a staging frame
+    GLsizeiptr streamStride() const { return UploadArena::capacityFor(stagedFrameBytes(), 1); }
+
+    void run();
+    void upload();
+    // refills the oldest uploaded staging frames with arena space whose copies completed,
+    // blocks for the oldest one if block is set
+    void retire(bool block);
+    // takes arena space for staging, false if block is not set and the space is still in use
+    bool reserve(Staging &staging, bool block);
+    // without persistent mapping: maps the next staging frame to fill once it is free and no
+    // other one is mapped
+    void mapForFill();
+    std::vector<uint8_t *> streamPointers(uint8_t *data) const;
+
+    uint32_t mUploadAhead = 1;
+    // state of the main context
+    GlState *mState = nullptr;
+    ResourcePool *mPool = nullptr;
+
+    mutable std::mutex mMutex;
+    std::condition_variable mCond;
+    std::atomic_bool mFinished = false;
+
+    UploadMonitor mMonitor;
+    GpuTimer mUploadTimer;
+    // CPU fill time, written by the fill thread
+    TimingStats mFillStats;
+
+    std::unique_ptr<UploadArena> mArena;
+    std::vector<Staging> mStaging;
+    uint32_t mFillIndex = 0;
+    uint32_t mUploadIndex = 0;
+    uint32_t mRetireIndex = 0;
+    // a staging frame is mapped for the fill thread, without persistent mapping
+    bool mFillMapped = false;
+
+    // texture ring, a frame is uploaded into mWriteFrame and drawn from mDrawFrame
+    std::vector<FrameSlot> mFrames;
+    uint32_t mWriteFrame = 0;
+    uint32_t mDrawFrame = 0;
+    // uploaded frames not yet released, including the one being drawn
+    uint32_t mReadyFrames = 0;
+
+    std::thread mThread;
+};
+
+#endif // SINGLECONTEXTUPLOAD_H
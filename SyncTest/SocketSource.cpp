@@ -0,0 +1,120 @@
+#include "SocketSource.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+namespace {
+double toMs(int64_t ns)
+{
+    return ns / 1e6;
+}
+} // namespace
+
+SocketSource::SocketSource(const std::string &address, uint32_t streams)
+    : mAddress(address), mStreams(streams)
+{
+    for (uint32_t i = 0; i < streams; ++i) {
+        Stream &stream = mStreams[i];
+        stream.socket = std::make_unique<SocketStream>(address);
+        SocketStreamHeader header;
+        const SocketBuffer buffer = {reinterpret_cast<uint8_t *>(&header), sizeof(header)};
+        if (!stream.socket->receive(&buffer, 1)
+            || std::memcmp(header.magic, socketStreamMagic, sizeof(socketStreamMagic)) != 0
+            || header.version != socketStreamVersion) {
+            printf("%s does not send version %u frame streams\n", address.c_str(),
+                   socketStreamVersion);
+            exit(1);
+        }
+        FrameFormat streamFormat;
+        streamFormat.pixelFormat = static_cast<PixelFormat>(header.pixelFormat);
+        streamFormat.width = header.width;
+        streamFormat.height = header.height;
+        if (!i) {
+            mFormat = streamFormat;
+            if (std::strcmp(pixelFormatName(mFormat.pixelFormat), "unknown") == 0
+                || !mFormat.width || !mFormat.height) {
+                printf("%s sends an invalid frame format\n", address.c_str());
+                exit(1);
+            }
+        } else if (streamFormat.pixelFormat != mFormat.pixelFormat
+                   || streamFormat.width != mFormat.width
+                   || streamFormat.height != mFormat.height) {
+            printf("Stream %u of %s sends other frames than stream 0\n", i, address.c_str());
+            exit(1);
+        }
+    }
+    printf("Receiving %ux%u %s frames from %s, %u streams\n", mFormat.width, mFormat.height,
+           pixelFormatName(mFormat.pixelFormat), address.c_str(), streams);
+}
+
+void SocketSource::readFrame(uint32_t streamIndex, uint64_t /*frame*/, uint8_t *dst,
+                             size_t pitch)
+{
+    Stream &stream = mStreams[streamIndex];
+    const size_t rowBytes = mFormat.sourceRowBytes();
+    const uint32_t rows = mFormat.uploadHeight();
+
+    // the header and the rows of the frame in one scatter list, packed rows as one buffer
+    SocketFrameHeader header;
+    stream.buffers.clear();
+    stream.buffers.push_back({reinterpret_cast<uint8_t *>(&header), sizeof(header)});
+    if (pitch == rowBytes) {
+        stream.buffers.push_back({dst, rowBytes * rows});
+    } else {
+        for (uint32_t y = 0; y < rows; ++y) {
+            stream.buffers.push_back({dst + y * pitch, rowBytes});
+        }
+    }
+
+    const int64_t start = SocketStream::now();
+    if (!stream.ended && !stream.socket->receive(stream.buffers.data(), stream.buffers.size())) {
+        stream.ended = true;
+        printf("Stream %u of %s ended after %llu frames\n", streamIndex, mAddress.c_str(),
+               static_cast<unsigned long long>(stream.frames));
+    }
+    if (stream.ended) {
+        for (uint32_t y = 0; y < rows; ++y) {
+            std::memset(dst + y * pitch, 0, rowBytes);
+        }
+        stream.missed++;
+        return;
+    }
+
+    const int64_t arrival = SocketStream::now();
+    stream.receives.add(toMs(arrival - start));
+    stream.latency.add(toMs(arrival - header.timestampNs));
+    if (stream.frames) {
+        stream.gaps.add(toMs(arrival - stream.lastNs));
+        // change of the transit time against the previous frame
+        const int64_t deviation =
+            std::llabs((arrival - stream.lastNs) - (header.timestampNs - stream.lastSentNs));
+        stream.jitterNs += (deviation - stream.jitterNs) / 16;
+        stream.maxDeviationNs = std::max(stream.maxDeviationNs, deviation);
+    } else {
+        stream.firstNs = arrival;
+    }
+    stream.lastNs = arrival;
+    stream.lastSentNs = header.timestampNs;
+    stream.frames++;
+}
+
+void SocketSource::printStats() const
+{
+    for (uint32_t i = 0; i < mStreams.size(); ++i) {
+        const Stream &stream = mStreams[i];
+        const double seconds = (stream.lastNs - stream.firstNs) / 1e9;
+        const double frames = stream.frames ? stream.frames - 1.0 : 0.0;
+        printf("Socket stream %u: %llu frames, %.1f fps, %.1f MB/s, jitter %.3f ms (max %.3f ms), "
+               "%llu missed\n",
+               i, static_cast<unsigned long long>(stream.frames),
+               seconds > 0 ? frames / seconds : 0.0,
+               seconds > 0 ? frames * mFormat.sourceFrameBytes() / 1e6 / seconds : 0.0,
+               stream.jitterNs / 1e6, toMs(stream.maxDeviationNs),
+               static_cast<unsigned long long>(stream.missed));
+        stream.gaps.print("arrival gap");
+        stream.latency.print("latency");
+        stream.receives.print("receive");
+    }
+}
@@ -0,0 +1,59 @@
+#ifndef SOCKETSOURCE_H
+#define SOCKETSOURCE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "FrameSource.h"
+#include "SocketStream.h"
+#include "TimingStats.h"
+
+// Plays frames a sender streams over a socket, one connection per stream; SocketSender is a
+// test sender. Frames are received by readFrame() straight into the destination, the mapped
+// upload arena when staging needs no conversion, with every row a buffer of the same scatter
+// receive, so the socket is the only copy. Every request takes the next frame of the stream,
+// waiting for it; once the sender closes a stream its frames are black. Arrival jitter uses
+// the send timestamps as in RFC 3550, which compares clocks only on the same machine.
+class SocketSource : public FrameSource
+{
+public:
+    // connects every stream to address, exits on errors
+    SocketSource(const std::string &address, uint32_t streams);
+
+    const char *name() const override { return "socket"; }
+    const FrameFormat &format() const override { return mFormat; }
+
+    void readFrame(uint32_t stream, uint64_t frame, uint8_t *dst, size_t pitch) override;
+
+    void printStats() const override;
+
+private:
+    struct Stream
+    {
+        std::unique_ptr<SocketStream> socket;
+        std::vector<SocketBuffer> buffers;
+        bool ended = false;
+
+        uint64_t frames = 0;
+        uint64_t missed = 0;
+        int64_t firstNs = 0;
+        int64_t lastNs = 0;
+        int64_t lastSentNs = 0;
+        // RFC 3550 interarrival jitter and its largest single sample, nanoseconds
+        double jitterNs = 0;
+        int64_t maxDeviationNs = 0;
+        // time between arrivals, from sending to arrival and blocked in receive
+        TimingStats gaps;
+        TimingStats latency;
+        TimingStats receives;
+    };
+
+    const std::string mAddress;
+    FrameFormat mFormat;
+    std::vector<Stream> mStreams;
+};
+
+#endif // SOCKETSOURCE_H
@@ -0,0 +1,317 @@
+#include "SocketStream.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#ifdef _WIN32
+#define NOMINMAX
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#else
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+namespace {
+// buffers per system call, below IOV_MAX everywhere
+const size_t socketBatchBuffers = 256;
+
+#ifdef _WIN32
+const SocketHandle invalidSocket = INVALID_SOCKET;
+#else
+const SocketHandle invalidSocket = -1;
+#endif
+
+struct Endpoint
+{
+    sockaddr_storage address = {};
+    socklen_t size = 0;
+    // socket file of a Unix domain socket
+    std::string path;
+};
+
+#ifdef _WIN32
+void startSockets()
+{
+    static const bool started = []() {
+        WSADATA data;
+        return WSAStartup(MAKEWORD(2, 2), &data) == 0;
+    }();
+    if (!started) {
+        printf("WSAStartup failed\n");
+        exit(1);
+    }
+}
+
+const char *lastError()
+{
+    thread_local char message[32];
+    snprintf(message, sizeof(message), "error %d", WSAGetLastError());
+    return message;
+}
+
+void closeSocket(SocketHandle socket)
+{
+    closesocket(socket);
+}
+#else
+void startSockets() {}
+
+const char *lastError()
+{
+    return strerror(errno);
+}
+
+void closeSocket(SocketHandle socket)
+{
+    close(socket);
+}
+#endif
+
+Endpoint resolve(const std::string &address)
+{
+    Endpoint endpoint;
+    if (address.rfind("unix:", 0) == 0) {
+#ifdef _WIN32
+        printf("Unix domain sockets are not supported on Windows, use tcp:PORT\n");
+        exit(1);
+#else
+        endpoint.path = address.substr(5);
+        sockaddr_un unixAddress = {};
+        unixAddress.sun_family = AF_UNIX;
+        if (endpoint.path.empty() || endpoint.path.size() >= sizeof(unixAddress.sun_path)) {
+            printf("Invalid socket path: %s\n", endpoint.path.c_str());
+            exit(1);
+        }
+        std::memcpy(unixAddress.sun_path, endpoint.path.c_str(), endpoint.path.size() + 1);
+        std::memcpy(&endpoint.address, &unixAddress, sizeof(unixAddress));
+        endpoint.size = sizeof(unixAddress);
+#endif
+    } else if (address.rfind("tcp:", 0) == 0) {
+        // a port alone is on the loopback interface
+        std::string host = "127.0.0.1";
+        std::string port = address.substr(4);
+        const size_t colon = port.rfind(':');
+        if (colon != std::string::npos) {
+            host = port.substr(0, colon);
+            port = port.substr(colon + 1);
+        }
+        addrinfo hints = {};
+        hints.ai_family = AF_UNSPEC;
+        hints.ai_socktype = SOCK_STREAM;
+        addrinfo *result = nullptr;
+        if (port.empty() || getaddrinfo(host.c_str(), port.c_str(), &hints, &result) != 0) {
+            printf("Cannot resolve %s\n", address.c_str());
+            exit(1);
+        }
+        std::memcpy(&endpoint.address, result->ai_addr, result->ai_addrlen);
+        endpoint.size = static_cast<socklen_t>(result->ai_addrlen);
+        freeaddrinfo(result);
+    } else {
+        printf("Invalid socket address %s, use unix:PATH, tcp:PORT or tcp:HOST:PORT\n",
+               address.c_str());
+        exit(1);
+    }
+    return endpoint;
+}
+
+SocketHandle openSocket(const Endpoint &endpoint, const std::string &address)
+{
+    const SocketHandle handle = socket(endpoint.address.ss_family, SOCK_STREAM, 0);
+    if (handle == invalidSocket) {
+        printf("Failed to create a socket for %s: %s\n", address.c_str(), lastError());
+        exit(1);
+    }
+    return handle;
+}
+
+// frames are sent whole, small headers go out without waiting for more data
+void setNoDelay(SocketHandle socket)
+{
+    const int enable = 1;
+    setsockopt(socket, IPPROTO_TCP, TCP_NODELAY, reinterpret_cast<const char *>(&enable),
+               sizeof(enable));
+}
+} // namespace
+
+SocketStream::SocketStream(const std::string &address) : mAddress(address)
+{
+    startSockets();
+    const Endpoint endpoint = resolve(address);
+    mSocket = openSocket(endpoint, address);
+    if (connect(mSocket, reinterpret_cast<const sockaddr *>(&endpoint.address), endpoint.size)
+        != 0) {
+        printf("Failed to connect to %s, start the sender first: %s\n", address.c_str(),
+               lastError());
+        exit(1);
+    }
+    if (endpoint.path.empty()) {
+        setNoDelay(mSocket);
+    }
+}
+
+SocketStream::SocketStream(SocketHandle socket, const std::string &address)
+    : mSocket(socket), mAddress(address)
+{
+}
+
+SocketStream::~SocketStream()
+{
+    closeSocket(mSocket);
+}
+
+bool SocketStream::receive(const SocketBuffer *buffers, size_t count)
+{
+    return transfer(buffers, count, false);
+}
+
+bool SocketStream::send(const SocketBuffer *buffers, size_t count)
+{
+    return transfer(buffers, count, true);
+}
+
+int64_t SocketStream::now()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+}
+
+bool SocketStream::transfer(const SocketBuffer *buffers, size_t count, bool sending)
+{
+    // position in the list: buffer next, offset bytes of it done
+    size_t next = 0;
+    size_t offset = 0;
+    for (;;) {
+        while (next < count && offset == buffers[next].size) {
+            next++;
+            offset = 0;
+        }
+        if (next == count) {
+            return true;
+        }
+
+        const size_t batch = std::min(count - next, socketBatchBuffers);
+#ifdef _WIN32
+        WSABUF vectors[socketBatchBuffers];
+        for (size_t i = 0; i < batch; ++i) {
+            const size_t skip = i ? 0 : offset;
+            vectors[i].buf = reinterpret_cast<CHAR *>(buffers[next + i].data + skip);
+            vectors[i].len = static_cast<ULONG>(buffers[next + i].size - skip);
+        }
+        DWORD done = 0;
+        DWORD flags = 0;
+        const int result =
+            sending ? WSASend(mSocket, vectors, static_cast<DWORD>(batch), &done, 0, nullptr,
+                              nullptr)
+                    : WSARecv(mSocket, vectors, static_cast<DWORD>(batch), &done, &flags, nullptr,
+                              nullptr);
+        if (result != 0) {
+            const int error = WSAGetLastError();
+            if (error == WSAECONNRESET || error == WSAECONNABORTED) {
+                return false;
+            }
+            printf("%s %s failed: %s\n", sending ? "Sending to" : "Receiving from",
+                   mAddress.c_str(), lastError());
+            exit(1);
+        }
+        size_t transferred = done;
+#else
+        iovec vectors[socketBatchBuffers];
+        for (size_t i = 0; i < batch; ++i) {
+            const size_t skip = i ? 0 : offset;
+            vectors[i].iov_base = buffers[next + i].data + skip;
+            vectors[i].iov_len = buffers[next + i].size - skip;
+        }
+        msghdr message = {};
+        message.msg_iov = vectors;
+        message.msg_iovlen = batch;
+#ifdef MSG_NOSIGNAL
+        const int sendFlags = MSG_NOSIGNAL;
+#else
+        const int sendFlags = 0;
+#endif
+        const ssize_t result = sending ? sendmsg(mSocket, &message, sendFlags)
+                                       : recvmsg(mSocket, &message, MSG_WAITALL);
+        if (result < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            if (errno == EPIPE || errno == ECONNRESET) {
+                return false;
+            }
+            printf("%s %s failed: %s\n", sending ? "Sending to" : "Receiving from",
+                   mAddress.c_str(), lastError());
+            exit(1);
+        }
+        size_t transferred = static_cast<size_t>(result);
+#endif
+        if (!transferred) {
+            return false;
+        }
+        while (transferred) {
+            const size_t step = std::min(transferred, buffers[next].size - offset);
+            offset += step;
+            transferred -= step;
+            if (offset == buffers[next].size) {
+                next++;
+                offset = 0;
+            }
+        }
+    }
+}
+
+SocketListener::SocketListener(const std::string &address) : mAddress(address)
+{
+    startSockets();
+    const Endpoint endpoint = resolve(address);
+    mSocket = openSocket(endpoint, address);
+    if (!endpoint.path.empty()) {
+#ifndef _WIN32
+        // a socket file left behind by a sender that was killed is replaced
+        unlink(endpoint.path.c_str());
+#endif
+        mPath = endpoint.path;
+    } else {
+        const int enable = 1;
+        setsockopt(mSocket, SOL_SOCKET, SO_REUSEADDR, reinterpret_cast<const char *>(&enable),
+                   sizeof(enable));
+    }
+    if (bind(mSocket, reinterpret_cast<const sockaddr *>(&endpoint.address), endpoint.size) != 0
+        || listen(mSocket, SOMAXCONN) != 0) {
+        printf("Failed to listen on %s: %s\n", address.c_str(), lastError());
+        exit(1);
+    }
+}
+
+SocketListener::~SocketListener()
+{
+    closeSocket(mSocket);
+#ifndef _WIN32
+    if (!mPath.empty()) {
+        unlink(mPath.c_str());
+    }
+#endif
+}
+
+std::unique_ptr<SocketStream> SocketListener::accept()
+{
+    const SocketHandle socket = ::accept(mSocket, nullptr, nullptr);
+    if (socket == invalidSocket) {
+        printf("Failed to accept a connection on %s: %s\n", mAddress.c_str(), lastError());
+        exit(1);
+    }
+    if (mPath.empty()) {
+        setNoDelay(socket);
+    }
+    return std::unique_ptr<SocketStream>(new SocketStream(socket, mAddress));
+}
@@ -0,0 +1,104 @@
+#ifndef SOCKETSTREAM_H
+#define SOCKETSTREAM_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+#include "PixelFormat.h"
+
+// Frames over a stream socket, one connection per stream. Addresses are unix:PATH for a Unix
+// domain socket (not on Windows), tcp:PORT for the loopback interface or tcp:HOST:PORT. The
+// sender listens; after accepting a connection it sends a SocketStreamHeader, then every frame
+// as a SocketFrameHeader followed by the frame as the producer writes it, sourceFrameBytes()
+// with rows sourceRowBytes() apart.
+
+const char socketStreamMagic[4] = {'S', 'F', 'S', 'K'};
+const uint32_t socketStreamVersion = 1;
+
+#pragma pack(push, 1)
+struct SocketStreamHeader
+{
+    char magic[4] = {};
+    uint32_t version = 0;
+    uint32_t pixelFormat = 0;
+    uint32_t width = 0;
+    uint32_t height = 0;
+};
+
+struct SocketFrameHeader
+{
+    // number of the frame in the stream
+    uint64_t sequence = 0;
+    // SocketStream::now() of the sender when the frame was sent
+    int64_t timestampNs = 0;
+};
+#pragma pack(pop)
+
+// piece of a scatter or gather transfer
+struct SocketBuffer
+{
+    uint8_t *data = nullptr;
+    size_t size = 0;
+};
+
+#ifdef _WIN32
+using SocketHandle = uintptr_t;
+#else
+using SocketHandle = int;
+#endif
+
+// Connected stream socket. Transfers take a list of buffers, handed to the system up to
+// socketBatchBuffers at a time with recvmsg/sendmsg (WSARecv/WSASend on Windows), so the rows
+// of a frame go straight to and from their memory without a copy in between.
+class SocketStream
+{
+public:
+    // connects to a sender listening on address, exits on errors
+    explicit SocketStream(const std::string &address);
+    ~SocketStream();
+
+    SocketStream(const SocketStream &) = delete;
+    SocketStream &operator=(const SocketStream &) = delete;
+
+    // fills all buffers, false if the peer closed the connection first; exits on errors
+    bool receive(const SocketBuffer *buffers, size_t count);
+    // sends all buffers, false if the peer closed the connection; exits on other errors
+    bool send(const SocketBuffer *buffers, size_t count);
+
+    // monotonic nanoseconds, comparable between processes of the machine
+    static int64_t now();
+
+private:
+    friend class SocketListener;
+    SocketStream(SocketHandle socket, const std::string &address);
+
+    // moves the whole list in batches, false if the connection was closed
+    bool transfer(const SocketBuffer *buffers, size_t count, bool sending);
+
+    SocketHandle mSocket;
+    const std::string mAddress;
+};
+
+class SocketListener
+{
+public:
+    // listens on address, replacing a stale Unix socket file; exits on errors
+    explicit SocketListener(const std::string &address);
+    ~SocketListener();
+
+    SocketListener(const SocketListener &) = delete;
+    SocketListener &operator=(const SocketListener &) = delete;
+
+    // waits for the next connection
+    std::unique_ptr<SocketStream> accept();
+
+private:
+    SocketHandle mSocket;
+    const std::string mAddress;
+    // socket file to remove, Unix domain sockets only
+    std::string mPath;
+};
+
+#endif // SOCKETSTREAM_H
@@ -0,0 +1,113 @@
+#include "StartupGraph.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+
+namespace {
+// initialized with the other statics before main(), close enough to process start
+const auto processStart = std::chrono::steady_clock::now();
+
+double sinceProcessStartMs()
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now()
+                                                     - processStart)
+        .count();
+}
+
+const char *const mainLane = "main";
+} // namespace
+
+void StartupGraph::add(std::string name, std::string lane, std::vector<std::string> dependencies,
+                       std::function<void()> task)
+{
+    auto entry = std::make_unique<Task>();
+    entry->name = std::move(name);
+    entry->lane = std::move(lane);
+    entry->function = std::move(task);
+    entry->future = entry->done.get_future().share();
+    for (const auto &dependency : dependencies) {
+        auto it = std::find_if(mTasks.begin(), mTasks.end(),
+                               [&](const auto &other) { return other->name == dependency; });
+        if (it == mTasks.end()) {
+            printf("Startup task %s depends on unknown task %s\n", entry->name.c_str(),
+                   dependency.c_str());
+            exit(1);
+        }
+        entry->dependencies.push_back(it->get());
+    }
+    mTasks.push_back(std::move(entry));
+}
+
+void StartupGraph::run()
+{
+    std::vector<std::string> lanes;
+    for (const auto &task : mTasks) {
+        if (task->lane != mainLane
+            && std::find(lanes.begin(), lanes.end(), task->lane) == lanes.end()) {
+            lanes.push_back(task->lane);
+        }
+    }
+
+    auto runLane = [this](const std::string &lane) {
+        for (auto &task : mTasks) {
+            if (task->lane == lane) {
+                runTask(*task);
+            }
+        }
+    };
+
+    std::vector<std::thread> threads;
+    for (const auto &lane : lanes) {
+        threads.emplace_back(runLane, lane);
+    }
+    runLane(mainLane);
+    for (auto &thread : threads) {
+        thread.join();
+    }
+}
+
+void StartupGraph::runTask(Task &task)
+{
+    for (const Task *dependency : task.dependencies) {
+        dependency->future.wait();
+    }
+    task.startMs = sinceProcessStartMs();
+    task.function();
+    task.endMs = sinceProcessStartMs();
+    task.done.set_value();
+}
+
+void StartupGraph::mark(const std::string &name)
+{
+    mMarks.emplace_back(name, sinceProcessStartMs());
+}
+
+void StartupGraph::printTimeline() const
+{
+    struct Entry
+    {
+        const std::string *lane;
+        const std::string *name;
+        double startMs;
+        double endMs;
+    };
+    std::vector<Entry> entries;
+    for (const auto &task : mTasks) {
+        entries.push_back({&task->lane, &task->name, task->startMs, task->endMs});
+    }
+    const std::string markLane = "-";
+    for (const auto &[name, ms] : mMarks) {
+        entries.push_back({&markLane, &name, ms, ms});
+    }
+    std::stable_sort(entries.begin(), entries.end(),
+                     [](const Entry &a, const Entry &b) { return a.startMs < b.startMs; });
+
+    printf("Startup timeline (ms since process start):\n");
+    for (const auto &entry : entries) {
+        printf("  %9.3f %9.3f %8.3f  %-8s %s\n", entry.startMs, entry.endMs,
+               entry.endMs - entry.startMs, entry.lane->c_str(), entry.name->c_str());
+    }
+}
@@ -0,0 +1,45 @@
+#ifndef STARTUPGRAPH_H
+#define STARTUPGRAPH_H
+
+#include <functional>
+#include <future>
+#include <memory>
+#include <string>
+#include <vector>
+
+// Startup sequence as a dependency graph. Every task runs on a lane: "main" is the thread
+// calling run(), any other lane gets its own thread for the duration of run(). A lane runs its
+// tasks in the order they were added, each one as soon as its dependencies are done.
+// Dependencies have to be added before their dependents, which rules out cycles and deadlocks.
+// Task and mark times are relative to process start.
+class StartupGraph
+{
+public:
+    void add(std::string name, std::string lane, std::vector<std::string> dependencies,
+             std::function<void()> task);
+    void run();
+
+    // records an event that is not a task, like the first presented frame
+    void mark(const std::string &name);
+    void printTimeline() const;
+
+private:
+    struct Task
+    {
+        std::string name;
+        std::string lane;
+        std::vector<const Task *> dependencies;
+        std::function<void()> function;
+        std::promise<void> done;
+        std::shared_future<void> future;
+        double startMs = 0;
+        double endMs = 0;
+    };
+
+    void runTask(Task &task);
+
+    std::vector<std::unique_ptr<Task>> mTasks;
+    std::vector<std::pair<std::string, double>> mMarks;
+};
+
+#endif // STARTUPGRAPH_H
@@ -0,0 +1,122 @@
+#include "SwapStats.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+
+#include "SDL2/SDL_timer.h"
+
+namespace {
+// intervals this far from the period are not used to measure the refresh rate
+const double measureTolerance = 0.25;
+// samples needed before the measured period replaces the nominal one
+const uint64_t measureMinSamples = 60;
+// frames returning later than this fraction of the period are late
+const double lateTolerance = 0.1;
+// frames taking at least this many periods skipped a vblank
+const double missedRatio = 1.5;
+} // namespace
+
+SwapStats::SwapStats(int refreshRate) : mRefreshRate(refreshRate)
+{
+    mNominalPeriodMs = refreshRate > 0 ? 1000.0 / refreshRate : 0;
+    mTicksPerSecond = SDL_GetPerformanceFrequency();
+}
+
+void SwapStats::onSwap()
+{
+    const uint64_t now = SDL_GetPerformanceCounter();
+    const uint64_t last = mLastSwap;
+    mLastSwap = now;
+    if (!last) {
+        return;
+    }
+    const double intervalMs = static_cast<double>(now - last) * 1000.0 / mTicksPerSecond;
+
+    mIntervalSumMs += intervalMs;
+    mIntervalSquaresSumMs += intervalMs * intervalMs;
+    mMaxIntervalMs = std::max(mMaxIntervalMs, intervalMs);
+
+    // unknown refresh rate: bootstrap the estimate from the first interval
+    const double reference = mMeasuredCount ? mMeasuredSumMs / mMeasuredCount
+                                            : (mNominalPeriodMs > 0 ? mNominalPeriodMs
+                                                                    : intervalMs);
+    if (std::abs(intervalMs - reference) < reference * measureTolerance) {
+        mMeasuredSumMs += intervalMs;
+        mMeasuredCount++;
+    }
+
+    const double period = periodMs();
+    if (period <= 0) {
+        mOnTime++;
+        return;
+    }
+
+    const double ratio = intervalMs / period;
+    if (ratio >= missedRatio) {
+        mMissed++;
+        mSkippedVblanks += static_cast<uint64_t>(std::lround(ratio)) - 1;
+    } else if (ratio >= 1.0 + lateTolerance) {
+        mLate++;
+    } else {
+        mOnTime++;
+    }
+
+    const double deviation = intervalMs - period;
+    const int bucket = static_cast<int>(
+        std::floor(deviation / histogramBucketMs + histogramBuckets / 2.0));
+    mHistogram[std::clamp(bucket + 1, 0, histogramBuckets + 1)]++;
+}
+
+double SwapStats::periodMs() const
+{
+    if (mMeasuredCount >= measureMinSamples || (mMeasuredCount && mNominalPeriodMs <= 0)) {
+        return mMeasuredSumMs / mMeasuredCount;
+    }
+    return mNominalPeriodMs;
+}
+
+double SwapStats::measuredRefreshRate() const
+{
+    return mMeasuredCount ? 1000.0 * mMeasuredCount / mMeasuredSumMs : 0;
+}
+
+void SwapStats::print() const
+{
+    const uint64_t count = frames();
+    printf("Swap statistics: %llu frames, refresh %i Hz nominal, %.3f Hz measured\n",
+           static_cast<unsigned long long>(count), mRefreshRate, measuredRefreshRate());
+    if (!count) {
+        return;
+    }
+    printf("  on-time %llu, late %llu, missed %llu (%llu vblanks skipped)\n",
+           static_cast<unsigned long long>(mOnTime), static_cast<unsigned long long>(mLate),
+           static_cast<unsigned long long>(mMissed),
+           static_cast<unsigned long long>(mSkippedVblanks));
+
+    const double mean = mIntervalSumMs / count;
+    const double variance = std::max(0.0, mIntervalSquaresSumMs / count - mean * mean);
+    printf("  interval: mean %.3f ms, jitter %.3f ms, max %.3f ms\n", mean, std::sqrt(variance),
+           mMaxIntervalMs);
+
+    const uint64_t maxBucket = *std::max_element(mHistogram.begin(), mHistogram.end());
+    printf("  deviation from %.3f ms period:\n", periodMs());
+    for (int i = 0; i < histogramBuckets + 2; ++i) {
+        if (!mHistogram[i]) {
+            continue;
+        }
+        const double from = (i - 1 - histogramBuckets / 2.0) * histogramBucketMs;
+        const double to = from + histogramBucketMs;
+        char range[32];
+        if (i == 0) {
+            snprintf(range, sizeof(range), "        < %+5.1f", to);
+        } else if (i == histogramBuckets + 1) {
+            snprintf(range, sizeof(range), "       >= %+5.1f", from);
+        } else {
+            snprintf(range, sizeof(range), "[%+5.1f, %+5.1f)", from, to);
+        }
+        const int barLength = static_cast<int>(40 * mHistogram[i] / maxBucket);
+        printf("    %s ms %8llu %.*s\n", range, static_cast<unsigned long long>(mHistogram[i]),
+               std::max(barLength, 1), "########################################");
+    }
+}
@@ -0,0 +1,57 @@
+#ifndef SWAPSTATS_H
+#define SWAPSTATS_H
+
+#include <array>
+#include <cstdint>
+
+// Timestamps every SDL_GL_SwapWindow return and classifies each frame against the display
+// refresh period: on-time, late (returned noticeably after the expected vblank) or missed
+// (one or more vblanks skipped).
+class SwapStats
+{
+public:
+    // refreshRate is SDL_DisplayMode::refresh_rate, 0 if unknown
+    explicit SwapStats(int refreshRate);
+
+    // call right after SDL_GL_SwapWindow returns
+    void onSwap();
+
+    // period used for classification: measured once enough samples are collected
+    double periodMs() const;
+    double measuredRefreshRate() const;
+
+    uint64_t frames() const { return mOnTime + mLate + mMissed; }
+    uint64_t onTime() const { return mOnTime; }
+    uint64_t late() const { return mLate; }
+    uint64_t missed() const { return mMissed; }
+
+    void print() const;
+
+private:
+    static constexpr int histogramBuckets = 32;
+    static constexpr double histogramBucketMs = 0.5;
+
+    int mRefreshRate = 0;
+    double mNominalPeriodMs = 0;
+
+    uint64_t mTicksPerSecond = 0;
+    uint64_t mLastSwap = 0;
+
+    // sum of intervals close to one period, used to estimate the real refresh period
+    double mMeasuredSumMs = 0;
+    uint64_t mMeasuredCount = 0;
+
+    uint64_t mOnTime = 0;
+    uint64_t mLate = 0;
+    uint64_t mMissed = 0;
+    uint64_t mSkippedVblanks = 0;
+
+    double mIntervalSumMs = 0;
+    double mIntervalSquaresSumMs = 0;
+    double mMaxIntervalMs = 0;
+
+    // deviation of interval from the period, [0] and [histogramBuckets + 1] are under/overflow
+    std::array<uint64_t, histogramBuckets + 2> mHistogram{};
+};
+
+#endif // SWAPSTATS_H
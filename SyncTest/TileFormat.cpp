@@ -0,0 +1,303 @@
+#include "TileFormat.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <utility>
+
+static_assert(sizeof(TileFileHeader) == 40, "the header is written as it is in memory");
+static_assert(sizeof(TileEntry) == 16, "tile entries are written as they are in memory");
+
+namespace {
+// control bytes below this start literals of control + 1 bytes, the others runs
+const uint8_t runFlag = 128;
+const size_t maxLiteral = 128;
+const size_t minRun = 3;
+const size_t maxRun = 255 - runFlag + minRun;
+
+size_t alignUp(size_t value)
+{
+    return (value + tileAlignment - 1) / tileAlignment * tileAlignment;
+}
+
+void appendLiterals(const uint8_t *data, size_t begin, size_t end, std::vector<uint8_t> &out)
+{
+    while (begin < end) {
+        const size_t count = std::min(maxLiteral, end - begin);
+        out.push_back(static_cast<uint8_t>(count - 1));
+        out.insert(out.end(), data + begin, data + begin + count);
+        begin += count;
+    }
+}
+
+void encodeRow(const uint8_t *data, size_t size, std::vector<uint8_t> &out)
+{
+    size_t literalStart = 0;
+    size_t i = 0;
+    while (i < size) {
+        size_t run = 1;
+        while (i + run < size && run < maxRun && data[i + run] == data[i]) {
+            run++;
+        }
+        if (run >= minRun) {
+            appendLiterals(data, literalStart, i, out);
+            out.push_back(static_cast<uint8_t>(runFlag + run - minRun));
+            out.push_back(data[i]);
+            i += run;
+            literalStart = i;
+        } else {
+            i++;
+        }
+    }
+    appendLiterals(data, literalStart, size, out);
+}
+
+// false if the row runs past the data or its tokens do not add up to size
+bool decodeRow(const uint8_t *data, size_t dataSize, size_t &pos, uint8_t *row, size_t size)
+{
+    size_t x = 0;
+    while (x < size) {
+        if (pos >= dataSize) {
+            return false;
+        }
+        const uint8_t control = data[pos++];
+        if (control < runFlag) {
+            const size_t count = control + 1u;
+            if (x + count > size || pos + count > dataSize) {
+                return false;
+            }
+            std::memcpy(row + x, data + pos, count);
+            pos += count;
+            x += count;
+        } else {
+            const size_t count = control - runFlag + minRun;
+            if (x + count > size || pos >= dataSize) {
+                return false;
+            }
+            std::memset(row + x, data[pos++], count);
+            x += count;
+        }
+    }
+    return true;
+}
+} // namespace
+
+bool isTileFile(const std::string &path)
+{
+    char magic[sizeof(tileMagic)] = {};
+    FILE *file = fopen(path.c_str(), "rb");
+    if (!file) {
+        return false;
+    }
+    const bool read = fread(magic, sizeof(magic), 1, file) == 1;
+    fclose(file);
+    return read && std::memcmp(magic, tileMagic, sizeof(tileMagic)) == 0;
+}
+
+TileCodec encodeTile(const uint8_t *rows, size_t pitch, size_t rowBytes, uint32_t count,
+                     std::vector<uint8_t> &out)
+{
+    const size_t start = out.size();
+    std::vector<uint8_t> residual(rowBytes);
+    for (uint32_t y = 0; y < count; ++y) {
+        const uint8_t *row = rows + y * pitch;
+        if (!y) {
+            encodeRow(row, rowBytes, out);
+            continue;
+        }
+        const uint8_t *above = row - pitch;
+        for (size_t x = 0; x < rowBytes; ++x) {
+            residual[x] = static_cast<uint8_t>(row[x] - above[x]);
+        }
+        encodeRow(residual.data(), rowBytes, out);
+    }
+
+    if (out.size() - start < rowBytes * count) {
+        return TileCodec::DeltaRle;
+    }
+    out.resize(start);
+    for (uint32_t y = 0; y < count; ++y) {
+        out.insert(out.end(), rows + y * pitch, rows + y * pitch + rowBytes);
+    }
+    return TileCodec::Stored;
+}
+
+bool decodeTile(const uint8_t *data, size_t size, TileCodec codec, uint8_t *dst, size_t pitch,
+                size_t rowBytes, uint32_t count, uint8_t *scratch)
+{
+    if (codec == TileCodec::Stored) {
+        if (size != rowBytes * count) {
+            return false;
+        }
+        for (uint32_t y = 0; y < count; ++y) {
+            std::memcpy(dst + y * pitch, data + y * rowBytes, rowBytes);
+        }
+        return true;
+    }
+    if (codec != TileCodec::DeltaRle) {
+        return false;
+    }
+
+    // rows are rebuilt in scratch, the destination is only written to
+    uint8_t *row = scratch;
+    uint8_t *above = scratch + rowBytes;
+    size_t pos = 0;
+    for (uint32_t y = 0; y < count; ++y) {
+        if (!decodeRow(data, size, pos, row, rowBytes)) {
+            return false;
+        }
+        if (y) {
+            for (size_t x = 0; x < rowBytes; ++x) {
+                row[x] = static_cast<uint8_t>(row[x] + above[x]);
+            }
+        }
+        std::memcpy(dst + y * pitch, row, rowBytes);
+        std::swap(row, above);
+    }
+    return pos == size;
+}
+
+TileWriter::TileWriter(const std::string &path, const FrameFormat &format, uint32_t tileRows)
+    : mPath(path), mFormat(format)
+{
+    mFile = fopen(path.c_str(), "wb");
+    if (!mFile) {
+        printf("Failed to create %s\n", path.c_str());
+        exit(1);
+    }
+    std::memcpy(mHeader.magic, tileMagic, sizeof(tileMagic));
+    mHeader.version = tileVersion;
+    mHeader.pixelFormat = static_cast<uint32_t>(format.pixelFormat);
+    mHeader.width = format.width;
+    mHeader.height = format.height;
+    mHeader.tileRows = tileRows;
+    mTiles = (format.uploadHeight() + tileRows - 1) / tileRows;
+    // rewritten by finish() once the frames and the index are known
+    write(&mHeader, sizeof(mHeader));
+}
+
+TileWriter::~TileWriter()
+{
+    if (mFile) {
+        fclose(mFile);
+    }
+}
+
+void TileWriter::addFrame(const uint8_t *frame, size_t pitch)
+{
+    pad();
+    mIndex.push_back(mOffset);
+
+    // tiles are compressed first, their offsets go into the entries in front of them
+    const size_t rowBytes = mFormat.sourceRowBytes();
+    const uint32_t rows = mFormat.uploadHeight();
+    const uint64_t dataStart = alignUp(mOffset + mTiles * sizeof(TileEntry));
+    std::vector<TileEntry> entries(mTiles);
+    mTile.clear();
+    for (uint32_t i = 0; i < mTiles; ++i) {
+        mTile.resize(alignUp(mTile.size()));
+        const uint32_t firstRow = i * mHeader.tileRows;
+        const uint32_t count = std::min(mHeader.tileRows, rows - firstRow);
+        const size_t start = mTile.size();
+        entries[i].codec = encodeTile(frame + firstRow * pitch, pitch, rowBytes, count, mTile);
+        entries[i].offset = dataStart + start;
+        entries[i].size = static_cast<uint32_t>(mTile.size() - start);
+    }
+    write(entries.data(), entries.size() * sizeof(TileEntry));
+    pad();
+    write(mTile.data(), mTile.size());
+    mInputBytes += rowBytes * rows;
+}
+
+void TileWriter::finish()
+{
+    pad();
+    mHeader.indexOffset = mOffset;
+    mHeader.frames = static_cast<uint32_t>(mIndex.size());
+    write(mIndex.data(), mIndex.size() * sizeof(uint64_t));
+    if (fseek(mFile, 0, SEEK_SET) != 0 || fwrite(&mHeader, sizeof(mHeader), 1, mFile) != 1
+        || fclose(mFile) != 0) {
+        printf("Failed to write %s\n", mPath.c_str());
+        exit(1);
+    }
+    mFile = nullptr;
+}
+
+void TileWriter::write(const void *data, size_t size)
+{
+    if (size && fwrite(data, size, 1, mFile) != 1) {
+        printf("Failed to write %s\n", mPath.c_str());
+        exit(1);
+    }
+    mOffset += size;
+}
+
+void TileWriter::pad()
+{
+    static const uint8_t zeros[tileAlignment] = {};
+    write(zeros, alignUp(mOffset) - mOffset);
+}
+
+TileFile::TileFile(const std::string &path) : mPath(path), mMapped(path)
+{
+    if (mMapped.size() < sizeof(mHeader)) {
+        printf("%s is not a tile container\n", path.c_str());
+        exit(1);
+    }
+    std::memcpy(&mHeader, mMapped.data(), sizeof(mHeader));
+    mFormat.pixelFormat = static_cast<PixelFormat>(mHeader.pixelFormat);
+    mFormat.width = mHeader.width;
+    mFormat.height = mHeader.height;
+    if (std::memcmp(mHeader.magic, tileMagic, sizeof(tileMagic)) != 0
+        || mHeader.version != tileVersion) {
+        printf("%s is not a version %u tile container\n", path.c_str(), tileVersion);
+        exit(1);
+    }
+    if (std::strcmp(pixelFormatName(mFormat.pixelFormat), "unknown") == 0 || !mFormat.width
+        || !mFormat.height || !mHeader.tileRows || !mHeader.frames
+        || mHeader.indexOffset > mMapped.size()
+        || (mMapped.size() - mHeader.indexOffset) / sizeof(uint64_t) < mHeader.frames) {
+        printf("%s has an invalid tile container header\n", path.c_str());
+        exit(1);
+    }
+    mTiles = (mFormat.uploadHeight() + mHeader.tileRows - 1) / mHeader.tileRows;
+}
+
+const TileEntry &TileFile::entry(uint32_t frame, uint32_t tile) const
+{
+    uint64_t frameOffset = 0;
+    std::memcpy(&frameOffset, mMapped.data() + mHeader.indexOffset + frame * sizeof(uint64_t),
+                sizeof(frameOffset));
+    const uint64_t offset = frameOffset + tile * sizeof(TileEntry);
+    // records start at tileAlignment boundaries, entries can be used in place
+    const auto *result = reinterpret_cast<const TileEntry *>(mMapped.data() + offset);
+    if (frameOffset % tileAlignment || offset + sizeof(TileEntry) > mHeader.indexOffset
+        || result->offset > mHeader.indexOffset
+        || result->size > mHeader.indexOffset - result->offset) {
+        printf("%s: tile %u of frame %u is out of bounds\n", mPath.c_str(), tile, frame);
+        exit(1);
+    }
+    return *result;
+}
+
+size_t TileFile::frameEnd(uint32_t frame) const
+{
+    if (frame + 1 >= mHeader.frames) {
+        return mHeader.indexOffset;
+    }
+    uint64_t next = 0;
+    std::memcpy(&next, mMapped.data() + mHeader.indexOffset + (frame + 1) * sizeof(uint64_t),
+                sizeof(next));
+    return next;
+}
+
+void TileFile::prefetch(uint32_t frame) const
+{
+    uint64_t begin = 0;
+    std::memcpy(&begin, mMapped.data() + mHeader.indexOffset + frame * sizeof(uint64_t),
+                sizeof(begin));
+    const size_t end = frameEnd(frame);
+    if (begin < end) {
+        mMapped.prefetch(begin, end - begin);
+    }
+}
@@ -0,0 +1,124 @@
+#ifndef TILEFORMAT_H
+#define TILEFORMAT_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "MappedFile.h"
+#include "PixelFormat.h"
+
+// Tile container: frames split into horizontal tiles of whole rows that are compressed and
+// decoded independently, so a frame decodes on many cores, each tile straight into its rows
+// of the destination at any row pitch. Layout, all values in host byte order:
+//   TileFileHeader
+//   per frame: a TileEntry for every tile, then the tile data
+//   frame index: offset of every frame record, at TileFileHeader::indexOffset
+// Frame records, tiles and the index start at tileAlignment boundaries. Rows are frames as
+// the producer writes them, FrameFormat::sourceRowBytes() each.
+
+const char tileMagic[4] = {'S', 'T', 'L', 'F'};
+const uint32_t tileVersion = 1;
+const size_t tileAlignment = 64;
+
+enum class TileCodec : uint32_t {
+    // rows copied as they are
+    Stored = 0,
+    // every row minus the row above it, the first row of a tile as is, then PackBits-like
+    // runs and literals of bytes per row
+    DeltaRle = 1,
+};
+
+struct TileFileHeader
+{
+    char magic[4] = {};
+    uint32_t version = 0;
+    uint32_t pixelFormat = 0;
+    uint32_t width = 0;
+    uint32_t height = 0;
+    // rows per tile, the last tile of a frame may have fewer
+    uint32_t tileRows = 0;
+    uint32_t frames = 0;
+    uint32_t reserved = 0;
+    uint64_t indexOffset = 0;
+};
+
+struct TileEntry
+{
+    // from the start of the file
+    uint64_t offset = 0;
+    uint32_t size = 0;
+    TileCodec codec = TileCodec::Stored;
+};
+
+// true if the file at path starts like a tile container
+bool isTileFile(const std::string &path);
+
+// compresses count rows of rowBytes, pitch apart, appends them to out and returns the codec
+// used; falls back to Stored when compression does not pay off
+TileCodec encodeTile(const uint8_t *rows, size_t pitch, size_t rowBytes, uint32_t count,
+                     std::vector<uint8_t> &out);
+// writes count rows of rowBytes, pitch apart, without ever reading dst, so it can be
+// write-combined mapped memory; scratch holds two rows. false for corrupt data.
+bool decodeTile(const uint8_t *data, size_t size, TileCodec codec, uint8_t *dst, size_t pitch,
+                size_t rowBytes, uint32_t count, uint8_t *scratch);
+
+// creates a container and appends frames to it, exits on I/O errors
+class TileWriter
+{
+public:
+    TileWriter(const std::string &path, const FrameFormat &format, uint32_t tileRows);
+    ~TileWriter();
+
+    // frame with rows of format.sourceRowBytes(), pitch apart
+    void addFrame(const uint8_t *frame, size_t pitch);
+    // writes the frame index and the final header
+    void finish();
+
+    uint64_t inputBytes() const { return mInputBytes; }
+    uint64_t outputBytes() const { return mOffset; }
+
+private:
+    void write(const void *data, size_t size);
+    void pad();
+
+    std::string mPath;
+    FILE *mFile = nullptr;
+    FrameFormat mFormat;
+    TileFileHeader mHeader;
+    uint32_t mTiles = 0;
+    std::vector<uint64_t> mIndex;
+    uint64_t mOffset = 0;
+    uint64_t mInputBytes = 0;
+    std::vector<uint8_t> mTile;
+};
+
+// container mapped for reading, exits if it is not valid
+class TileFile
+{
+public:
+    explicit TileFile(const std::string &path);
+
+    const FrameFormat &format() const { return mFormat; }
+    uint32_t frames() const { return mHeader.frames; }
+    uint32_t tileRows() const { return mHeader.tileRows; }
+    uint32_t tiles() const { return mTiles; }
+
+    const TileEntry &entry(uint32_t frame, uint32_t tile) const;
+    const uint8_t *data(const TileEntry &entry) const { return mMapped.data() + entry.offset; }
+    // asks for the pages of the frame record ahead of decoding
+    void prefetch(uint32_t frame) const;
+
+private:
+    size_t frameEnd(uint32_t frame) const;
+
+    std::string mPath;
+    MappedFile mMapped;
+    TileFileHeader mHeader;
+    FrameFormat mFormat;
+    uint32_t mTiles = 0;
+};
+
+#endif // TILEFORMAT_H
@@ -0,0 +1,141 @@
+#include "TileSource.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+
+TileSource::TileSource(const std::string &path, uint32_t streams, uint32_t threads)
+    : mFile(path), mStreams(streams)
+{
+    if (!threads) {
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    // more threads than tiles would only wait
+    threads = std::min(threads, mFile.tiles());
+    const size_t rowBytes = format().sourceRowBytes();
+    for (uint32_t i = 0; i < threads; ++i) {
+        mScratch.push_back(std::make_unique<uint8_t[]>(rowBytes * 2));
+    }
+    for (uint32_t i = 1; i < threads; ++i) {
+        mThreads.emplace_back([this, i]() { run(i); });
+    }
+
+    const FrameFormat &frameFormat = format();
+    printf("Playing %s: %u %ux%u %s frames in %u tiles of %u rows, %u decode threads\n",
+           path.c_str(), mFile.frames(), frameFormat.width, frameFormat.height,
+           pixelFormatName(frameFormat.pixelFormat), mFile.tiles(), mFile.tileRows(), threads);
+    for (uint32_t stream = 0; stream < mStreams; ++stream) {
+        mFile.prefetch(static_cast<uint32_t>(uint64_t{stream} * mFile.frames() / mStreams));
+    }
+}
+
+TileSource::~TileSource()
+{
+    {
+        std::lock_guard guard(mMutex);
+        mFinished = true;
+    }
+    mWake.notify_all();
+    for (auto &thread : mThreads) {
+        thread.join();
+    }
+}
+
+bool TileSource::clipFrame(uint32_t stream, uint64_t frame, uint64_t &index) const
+{
+    const uint64_t frames = mFile.frames();
+    index = (stream * frames / mStreams + frame) % frames;
+    return true;
+}
+
+void TileSource::readFrame(uint32_t stream, uint64_t frame, uint8_t *dst, size_t pitch)
+{
+    const uint64_t frames = mFile.frames();
+    uint64_t index = 0;
+    clipFrame(stream, frame, index);
+    // the record of the next frame is paged in while this one decodes
+    mFile.prefetch(static_cast<uint32_t>((index + 1) % frames));
+
+    const auto start = std::chrono::steady_clock::now();
+    {
+        std::lock_guard guard(mMutex);
+        mFrame = static_cast<uint32_t>(index);
+        mDst = dst;
+        mPitch = pitch;
+        mNextTile = 0;
+        mBusy = static_cast<uint32_t>(mThreads.size());
+        ++mGeneration;
+    }
+    mWake.notify_all();
+    decodeTiles(0);
+    {
+        std::unique_lock lock(mMutex);
+        mDone.wait(lock, [this]() { return !mBusy; });
+    }
+    if (mCorrupt) {
+        printf("Frame %llu of the tile container is corrupt\n",
+               static_cast<unsigned long long>(index));
+        exit(1);
+    }
+
+    const std::chrono::duration<double> seconds = std::chrono::steady_clock::now() - start;
+    mFrames++;
+    mDecodedBytes += format().sourceFrameBytes();
+    mDecodeSeconds += seconds.count();
+    mDecodes.add(seconds.count() * 1000.0);
+}
+
+void TileSource::printStats() const
+{
+    if (!mFrames) {
+        return;
+    }
+    printf("Tile decode: %llu frames, %.1f MB read for %.1f MB, %.2f GB/s on %u threads\n",
+           static_cast<unsigned long long>(mFrames), mCompressedBytes / 1e6,
+           mDecodedBytes / 1e6, mDecodeSeconds > 0 ? mDecodedBytes / 1e9 / mDecodeSeconds : 0.0,
+           threads());
+    mDecodes.print("tile decode");
+}
+
+void TileSource::run(uint32_t worker)
+{
+    uint64_t generation = 0;
+    for (;;) {
+        {
+            std::unique_lock lock(mMutex);
+            mWake.wait(lock, [&]() { return mFinished || mGeneration != generation; });
+            if (mFinished) {
+                return;
+            }
+            generation = mGeneration;
+        }
+        decodeTiles(worker);
+        {
+            std::lock_guard guard(mMutex);
+            if (!--mBusy) {
+                mDone.notify_one();
+            }
+        }
+    }
+}
+
+void TileSource::decodeTiles(uint32_t worker)
+{
+    const FrameFormat &frameFormat = format();
+    const size_t rowBytes = frameFormat.sourceRowBytes();
+    const uint32_t rows = frameFormat.uploadHeight();
+    const uint32_t tileRows = mFile.tileRows();
+    uint8_t *scratch = mScratch[worker].get();
+    uint64_t compressed = 0;
+    for (uint32_t tile = mNextTile++; tile < mFile.tiles(); tile = mNextTile++) {
+        const TileEntry &entry = mFile.entry(mFrame, tile);
+        const uint32_t firstRow = tile * tileRows;
+        if (!decodeTile(mFile.data(entry), entry.size, entry.codec, mDst + firstRow * mPitch,
+                        mPitch, rowBytes, std::min(tileRows, rows - firstRow), scratch)) {
+            mCorrupt = true;
+        }
+        compressed += entry.size;
+    }
+    mCompressedBytes += compressed;
+}
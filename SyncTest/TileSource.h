@@ -0,0 +1,72 @@
+#ifndef TILESOURCE_H
+#define TILESOURCE_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "FrameSource.h"
+#include "TileFormat.h"
+#include "TimingStats.h"
+
+// Plays a tile container (see TileFormat.h). The tiles of a frame are decoded in parallel by
+// a pool of threads and the calling thread, each one straight into its rows of the destination,
+// which is the mapped upload arena whenever the format needs no conversion. The next frame
+// record is prefetched while the current one decodes. The file loops, the streams play it
+// shifted by an equal share of its length.
+class TileSource : public FrameSource
+{
+public:
+    // threads decoding a frame including the caller, 0 for one per core; exits on errors
+    TileSource(const std::string &path, uint32_t streams, uint32_t threads);
+    ~TileSource() override;
+
+    const char *name() const override { return "tiles"; }
+    const FrameFormat &format() const override { return mFile.format(); }
+    uint32_t frameCount() const { return mFile.frames(); }
+    uint32_t threads() const { return static_cast<uint32_t>(mScratch.size()); }
+    bool clipFrame(uint32_t stream, uint64_t frame, uint64_t &index) const override;
+
+    void readFrame(uint32_t stream, uint64_t frame, uint8_t *dst, size_t pitch) override;
+
+    void printStats() const override;
+
+private:
+    void run(uint32_t worker);
+    // takes tiles of the current frame until none are left
+    void decodeTiles(uint32_t worker);
+
+    TileFile mFile;
+    const uint32_t mStreams = 1;
+    // two rows per thread for the decoder, the caller uses the first
+    std::vector<std::unique_ptr<uint8_t[]>> mScratch;
+
+    // frame being decoded, set under mMutex before the workers are woken
+    uint32_t mFrame = 0;
+    uint8_t *mDst = nullptr;
+    size_t mPitch = 0;
+    std::atomic<uint32_t> mNextTile = 0;
+    std::atomic<uint64_t> mCompressedBytes = 0;
+    std::atomic_bool mCorrupt = false;
+
+    std::mutex mMutex;
+    std::condition_variable mWake;
+    std::condition_variable mDone;
+    uint64_t mGeneration = 0;
+    uint32_t mBusy = 0;
+    bool mFinished = false;
+    std::vector<std::thread> mThreads;
+
+    uint64_t mFrames = 0;
+    uint64_t mDecodedBytes = 0;
+    double mDecodeSeconds = 0;
+    TimingStats mDecodes;
+};
+
+#endif // TILESOURCE_H
@@ -0,0 +1,22 @@
+#include "TimingStats.h"
+
+#include <algorithm>
+#include <cstdio>
+
+void TimingStats::add(double ms)
+{
+    mMinMs = mCount ? std::min(mMinMs, ms) : ms;
+    mMaxMs = std::max(mMaxMs, ms);
+    mSumMs += ms;
+    mCount++;
+}
+
+void TimingStats::print(const char *name) const
+{
+    if (!mCount) {
+        printf("  %-12s no samples\n", name);
+        return;
+    }
+    printf("  %-12s avg %.3f ms, min %.3f ms, max %.3f ms (%llu samples)\n", name, averageMs(),
+           mMinMs, mMaxMs, static_cast<unsigned long long>(mCount));
+}
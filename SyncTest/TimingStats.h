@@ -0,0 +1,26 @@
+#ifndef TIMINGSTATS_H
+#define TIMINGSTATS_H
+
+#include <cstdint>
+
+// Accumulates durations in milliseconds
+class TimingStats
+{
+public:
+    void add(double ms);
+
+    uint64_t count() const { return mCount; }
+    double averageMs() const { return mCount ? mSumMs / mCount : 0; }
+    double minMs() const { return mMinMs; }
+    double maxMs() const { return mMaxMs; }
+
+    void print(const char *name) const;
+
+private:
+    uint64_t mCount = 0;
+    double mSumMs = 0;
+    double mMinMs = 0;
+    double mMaxMs = 0;
+};
+
+#endif // TIMINGSTATS_H
@@ -0,0 +1,254 @@
+#include "UploadArena.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <numeric>
+
+#include "SDL2/SDL_timer.h"
+
+#include "GlState.h"
+#include "ResourcePool.h"
+
+namespace {
+const GLbitfield persistentFlags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT
+                                   | GL_MAP_COHERENT_BIT;
+const GLuint64 waitTimeoutNs = 1000000000;
+
+GLintptr alignUp(GLintptr value)
+{
+    const GLintptr alignment = static_cast<GLintptr>(UploadArena::alignment);
+    return (value + alignment - 1) / alignment * alignment;
+}
+} // namespace
+
+UploadArena::UploadArena(GlState &state, ResourcePool &pool, GLsizeiptr capacity)
+    : mState(state), mPool(pool), mCapacity(alignUp(capacity))
+{
+    mPersistent = GLAD_GL_VERSION_4_4 != 0;
+    mStats.capacity = mCapacity;
+    mStats.persistent = mPersistent;
+    mBuffer = pool.acquireBuffer(state, GL_PIXEL_UNPACK_BUFFER, mCapacity,
+                                 mPersistent ? persistentFlags : GL_MAP_WRITE_BIT);
+    if (mPersistent) {
+        mBase = static_cast<uint8_t *>(
+            state.mapBuffer(GL_PIXEL_UNPACK_BUFFER, mBuffer, 0, mCapacity, persistentFlags));
+        if (!mBase) {
+            printf("glMapBufferRange failed\n");
+            exit(1);
+        }
+    }
+}
+
+UploadArena::~UploadArena()
+{
+    if (mBuffer) {
+        printf("Upload arena was not destroyed\n");
+    }
+}
+
+size_t UploadArena::rowPitch(size_t rowBytes, size_t texelBytes)
+{
+    // RGB8 texels of three bytes pad to 768 bytes
+    const size_t step = std::lcm(alignment, texelBytes);
+    return (rowBytes + step - 1) / step * step;
+}
+
+GLsizeiptr UploadArena::capacityFor(GLsizeiptr size, size_t count)
+{
+    // allocate() starts every allocation aligned, the padding after each one is taken as well
+    return alignUp(size) * static_cast<GLsizeiptr>(count);
+}
+
+GLintptr UploadArena::findOffset(GLsizeiptr capacity, GLintptr tail, GLintptr end,
+                                 GLsizeiptr size)
+{
+    if (tail < 0) {
+        return size <= capacity ? 0 : -1;
+    }
+    const GLintptr head = alignUp(end);
+    if (end > tail) {
+        // live bytes do not wrap: free space after them or at the start
+        if (head + size <= capacity) {
+            return head;
+        }
+        return size <= tail ? 0 : -1;
+    }
+    return head + size <= tail ? head : -1;
+}
+
+bool UploadArena::allocate(GLsizeiptr size, Allocation &result, bool wait)
+{
+    if (size <= 0 || size > mCapacity) {
+        printf("Upload arena allocation of %lld bytes does not fit %lld\n",
+               static_cast<long long>(size), static_cast<long long>(mCapacity));
+        exit(1);
+    }
+    const uint64_t waitStart = SDL_GetPerformanceCounter();
+    bool waited = false;
+    while (true) {
+        const GLintptr offset =
+            mRegions.empty() ? findOffset(mCapacity, -1, -1, size)
+                             : findOffset(mCapacity, mRegions.front().begin,
+                                          mRegions.back().end, size);
+        if (offset >= 0) {
+            mRegions.push_back({offset, offset + size, nullptr});
+            result = {offset, size};
+            break;
+        }
+        if (!mRegions.front().sync) {
+            printf("Upload arena of %lld bytes is full of unfenced allocations\n",
+                   static_cast<long long>(mCapacity));
+            exit(1);
+        }
+        if (!retireOldest(wait)) {
+            return false;
+        }
+        waited = true;
+    }
+    if (waited) {
+        mStats.waits.add((SDL_GetPerformanceCounter() - waitStart) * 1000.0
+                   / SDL_GetPerformanceFrequency());
+    }
+    mStats.allocations++;
+    mStats.bytes += static_cast<uint64_t>(size);
+    return true;
+}
+
+uint8_t *UploadArena::map(const Allocation &allocation)
+{
+    if (mPersistent) {
+        return mBase + allocation.offset;
+    }
+    // the ring and its fences already keep the GL away from this range
+    auto data = static_cast<uint8_t *>(mState.mapBuffer(
+        GL_PIXEL_UNPACK_BUFFER, mBuffer, allocation.offset, allocation.size,
+        GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT));
+    if (!data) {
+        printf("glMapBufferRange failed\n");
+        exit(1);
+    }
+    return data;
+}
+
+void UploadArena::unmap(const Allocation &)
+{
+    if (!mPersistent) {
+        mState.unmapBuffer(GL_PIXEL_UNPACK_BUFFER, mBuffer);
+    }
+}
+
+GLsync UploadArena::fence()
+{
+    // nothing to guard, no sync object that would be deleted right away
+    if (mRegions.empty() || mRegions.back().sync) {
+        return nullptr;
+    }
+    GLsync sync = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    fence(sync, {});
+    return sync;
+}
+
+GLsync UploadArena::fence(const Allocation &last)
+{
+    // fenced regions are the oldest ones, the unfenced ones follow them
+    auto it = mRegions.begin();
+    while (it != mRegions.end() && it->sync) {
+        ++it;
+    }
+    auto end = it;
+    while (end != mRegions.end() && end->begin != last.offset) {
+        ++end;
+    }
+    if (end == mRegions.end()) {
+        printf("Upload arena allocation at %lld is not waiting for a fence\n",
+               static_cast<long long>(last.offset));
+        exit(1);
+    }
+    GLsync sync = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    for (++end; it != end; ++it) {
+        it->sync = sync;
+    }
+    mFences.push_back({sync, {}});
+    return sync;
+}
+
+void UploadArena::fence(GLsync sync, std::function<void()> release)
+{
+    Fence fence{sync, std::move(release)};
+    bool guards = false;
+    for (auto it = mRegions.rbegin(); it != mRegions.rend() && !it->sync; ++it) {
+        it->sync = sync;
+        guards = true;
+    }
+    if (!guards) {
+        retire(fence);
+        return;
+    }
+    mFences.push_back(std::move(fence));
+}
+
+void UploadArena::setRetireCallback(std::function<void(GLsync)> callback)
+{
+    mRetireCallback = std::move(callback);
+}
+
+bool UploadArena::retireOldest(bool wait)
+{
+    GLsync sync = mRegions.front().sync;
+    GLenum result;
+    do {
+        result = glClientWaitSync(sync, wait ? GL_SYNC_FLUSH_COMMANDS_BIT : 0,
+                                  wait ? waitTimeoutNs : 0);
+    } while (wait && result == GL_TIMEOUT_EXPIRED);
+    if (result == GL_TIMEOUT_EXPIRED) {
+        return false;
+    }
+    if (result == GL_WAIT_FAILED) {
+        printf("glClientWaitSync failed\n");
+        exit(1);
+    }
+    while (!mRegions.empty() && mRegions.front().sync == sync) {
+        mRegions.pop_front();
+    }
+    retire(mFences.front());
+    mFences.pop_front();
+    return true;
+}
+
+void UploadArena::retire(Fence &fence)
+{
+    if (mRetireCallback) {
+        mRetireCallback(fence.sync);
+    }
+    if (fence.release) {
+        fence.release();
+    } else {
+        glDeleteSync(fence.sync);
+    }
+}
+
+void UploadArena::destroy()
+{
+    if (!mBuffer) {
+        return;
+    }
+    while (!mRegions.empty() && mRegions.front().sync) {
+        retireOldest(true);
+    }
+    mRegions.clear();
+    // fences of regions never fenced do not exist, the rest went with their regions
+    mFences.clear();
+    if (mPersistent) {
+        mState.unmapBuffer(GL_PIXEL_UNPACK_BUFFER, mBuffer);
+    }
+    mPool.releaseBuffer(mBuffer);
+    mBuffer = 0;
+}
+
+void UploadArena::Stats::print(const char *name) const
+{
+    printf("Upload arena %s: %.1f MB %s, %llu allocations %.1f MB\n", name,
+           capacity / (1024.0 * 1024.0), persistent ? "persistently mapped" : "mapped per use",
+           static_cast<unsigned long long>(allocations), bytes / (1024.0 * 1024.0));
+    waits.print("fence waits");
+}
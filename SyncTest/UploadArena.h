@@ -0,0 +1,123 @@
+#ifndef UPLOADARENA_H
+#define UPLOADARENA_H
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+
+#include "glad/gl.h"
+
+#include "TimingStats.h"
+
+class GlState;
+class ResourcePool;
+
+// One large pixel unpack buffer per upload context, sub-allocated as a ring. Every frame of
+// every stream gets an offset aligned to 256 bytes and rows padded to the same alignment, and
+// the texture uploads read from offsets into the one buffer. fence() guards everything
+// allocated since the previous fence; allocations wrap around and wait on the oldest fences
+// when the ring is full. With GL 4.4 the buffer is mapped persistently once, otherwise every
+// allocation is mapped unsynchronized on its own. Used with its context current.
+class UploadArena
+{
+public:
+    static constexpr size_t alignment = 256;
+
+    struct Allocation
+    {
+        GLintptr offset = 0;
+        GLsizeiptr size = 0;
+    };
+
+    struct Stats
+    {
+        GLsizeiptr capacity = 0;
+        bool persistent = false;
+        uint64_t allocations = 0;
+        uint64_t bytes = 0;
+        // time allocations spent blocked on fences
+        TimingStats waits;
+
+        void print(const char *name) const;
+    };
+
+    UploadArena(GlState &state, ResourcePool &pool, GLsizeiptr capacity);
+    ~UploadArena();
+
+    bool persistent() const { return mPersistent; }
+    GLuint buffer() const { return mBuffer; }
+
+    // waits for the oldest fences until size bytes are free, returns false instead if wait is
+    // not set and the space is still in use
+    bool allocate(GLsizeiptr size, Allocation &result, bool wait = true);
+    // CPU address of the allocation; without persistent mapping the range is mapped until
+    // unmap(), which has to happen before GL reads it
+    uint8_t *map(const Allocation &allocation);
+    void unmap(const Allocation &allocation);
+    // fence after the GL commands reading the allocations made since the previous fence, null
+    // if there are none; the arena owns and deletes it
+    GLsync fence();
+    // fence after the GL commands reading the oldest allocations not fenced yet, up to and
+    // including last, for owners that fill allocations ahead of the commands reading them
+    GLsync fence(const Allocation &last);
+    // guards them with a fence of the caller instead, which has to stay alive until release is
+    // called; saves a second sync object when the commands are fenced anyway
+    void fence(GLsync sync, std::function<void()> release);
+    // called with each fence just before the arena deletes it
+    void setRetireCallback(std::function<void(GLsync)> callback);
+
+    // waits for every fence, unmaps and returns the buffer to the pool
+    void destroy();
+
+    // copied by the owner so it can be printed while another thread uses the arena
+    const Stats &stats() const { return mStats; }
+
+    // bytes between row starts for rows of rowBytes: aligned, and a whole number of texels of
+    // texelBytes so GL_UNPACK_ROW_LENGTH can express it
+    static size_t rowPitch(size_t rowBytes, size_t texelBytes);
+    // capacity that holds count allocations of size at once, each starting aligned
+    static GLsizeiptr capacityFor(GLsizeiptr size, size_t count);
+    // where the ring places size bytes when its live bytes start at tail and the newest ends
+    // at end, wrapped if end <= tail; -1 if they do not fit. No live bytes is tail = end = -1.
+    static GLintptr findOffset(GLsizeiptr capacity, GLintptr tail, GLintptr end,
+                               GLsizeiptr size);
+
+private:
+    struct Region
+    {
+        GLintptr begin = 0;
+        GLintptr end = 0;
+        // null until fenced
+        GLsync sync = nullptr;
+    };
+
+    struct Fence
+    {
+        GLsync sync = nullptr;
+        // empty for fences the arena created and deletes
+        std::function<void()> release;
+    };
+
+    // frees the regions of the oldest fence, false if it has not signalled and wait is not set
+    bool retireOldest(bool wait);
+    // called with each fence once no region is guarded by it any more
+    void retire(Fence &fence);
+
+    GlState &mState;
+    ResourcePool &mPool;
+    GLsizeiptr mCapacity = 0;
+    GLuint mBuffer = 0;
+    bool mPersistent = false;
+    uint8_t *mBase = nullptr;
+
+    // live regions from oldest to newest
+    std::deque<Region> mRegions;
+    // fences guarding live regions, oldest first
+    std::deque<Fence> mFences;
+    std::function<void(GLsync)> mRetireCallback;
+
+    Stats mStats;
+};
+
+#endif // UPLOADARENA_H
@@ -0,0 +1,72 @@
+#include "UploadMonitor.h"
+
+#include <algorithm>
+#include <cstdio>
+
+#include "SDL2/SDL_timer.h"
+
+void UploadMonitor::track(GLsync sync, uint64_t bytes, std::function<void()> onSignalled)
+{
+    std::lock_guard guard(mMutex);
+    mPending.push_back({sync, bytes, SDL_GetPerformanceCounter(), std::move(onSignalled)});
+}
+
+void UploadMonitor::poll()
+{
+    while (true) {
+        Pending pending;
+        {
+            std::lock_guard guard(mMutex);
+            if (mPending.empty()) {
+                return;
+            }
+            // fences of one context signal in order, the oldest one decides
+            const GLenum result = glClientWaitSync(mPending.front().sync, 0, 0);
+            if (result != GL_ALREADY_SIGNALED && result != GL_CONDITION_SATISFIED) {
+                return;
+            }
+            pending = std::move(mPending.front());
+            mPending.pop_front();
+            record(pending, SDL_GetPerformanceCounter());
+        }
+        if (pending.onSignalled) {
+            pending.onSignalled();
+        }
+    }
+}
+
+void UploadMonitor::observed(GLsync sync)
+{
+    std::lock_guard guard(mMutex);
+    auto it = std::find_if(mPending.begin(), mPending.end(),
+                           [sync](const Pending &pending) { return pending.sync == sync; });
+    if (it != mPending.end()) {
+        record(*it, SDL_GetPerformanceCounter());
+        mPending.erase(it);
+    }
+}
+
+void UploadMonitor::record(const Pending &pending, uint64_t now)
+{
+    const double latencyMs = static_cast<double>(now - pending.submitTicks) * 1000.0
+                             / SDL_GetPerformanceFrequency();
+    mLatencyMinMs = mBatches ? std::min(mLatencyMinMs, latencyMs) : latencyMs;
+    mLatencyMaxMs = std::max(mLatencyMaxMs, latencyMs);
+    mLatencySumMs += latencyMs;
+    mBytes += pending.bytes;
+    mBatches++;
+}
+
+void UploadMonitor::printStats() const
+{
+    std::lock_guard guard(mMutex);
+    if (!mBatches) {
+        printf("Upload completion: no fences observed\n");
+        return;
+    }
+    printf("Upload completion: %llu batches, %.1f MB per batch, latency avg %.3f ms, "
+           "min %.3f ms, max %.3f ms, %.2f GB/s\n",
+           static_cast<unsigned long long>(mBatches), mBytes / 1e6 / mBatches,
+           mLatencySumMs / mBatches, mLatencyMinMs, mLatencyMaxMs,
+           mLatencySumMs > 0 ? mBytes / 1e6 / mLatencySumMs : 0.0);
+}
@@ -0,0 +1,50 @@
+#ifndef UPLOADMONITOR_H
+#define UPLOADMONITOR_H
+
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+
+#include "glad/gl.h"
+
+// Polls upload fences with zero-timeout glClientWaitSync and records when the GPU signalled
+// them, which gives the real duration and throughput of the PBO->texture copies. Polling
+// never blocks, so it can be done whenever the owning thread would otherwise sleep.
+// Latency is measured from the flush of the fence to the poll that saw it signalled, so it
+// includes time queued behind other GPU work and the polling interval.
+class UploadMonitor
+{
+public:
+    // sync fences uploads of bytes and was flushed; it has to stay alive until onSignalled is
+    // called from poll() or until observed() is called by the owner
+    void track(GLsync sync, uint64_t bytes, std::function<void()> onSignalled = {});
+    // called with the context that created the fences current
+    void poll();
+    // the owner saw sync signalled itself and is going to delete it
+    void observed(GLsync sync);
+
+    void printStats() const;
+
+private:
+    struct Pending
+    {
+        GLsync sync = 0;
+        uint64_t bytes = 0;
+        uint64_t submitTicks = 0;
+        std::function<void()> onSignalled;
+    };
+
+    void record(const Pending &pending, uint64_t now);
+
+    mutable std::mutex mMutex;
+    std::deque<Pending> mPending;
+
+    uint64_t mBatches = 0;
+    uint64_t mBytes = 0;
+    double mLatencySumMs = 0;
+    double mLatencyMinMs = 0;
+    double mLatencyMaxMs = 0;
+};
+
+#endif // UPLOADMONITOR_H
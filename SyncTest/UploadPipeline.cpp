@@ -0,0 +1,84 @@
+#include "UploadPipeline.h"
+
+#include <cstdio>
+
+#include "Frame.h"
+#include "GlState.h"
+#include "HalfFloat.h"
+#include "ResourcePool.h"
+#include "UploadArena.h"
+
+void UploadPipeline::prepare()
+{
+    mPreparedFrames.clear();
+    for (uint32_t i = 0; i < mStreams; ++i) {
+        auto data = std::make_unique<uint8_t[]>(mFormat.sourceFrameBytes());
+        mSource.readFrame(i, 0, data.get(), mFormat.sourceRowBytes());
+        mPreparedFrames.push_back(std::move(data));
+    }
+}
+
+std::unique_ptr<uint8_t[]> UploadPipeline::takePreparedFrame(uint32_t stream)
+{
+    if (stream >= mPreparedFrames.size()) {
+        return {};
+    }
+    return std::move(mPreparedFrames[stream]);
+}
+
+GLuint UploadPipeline::acquireTexture(GlState &state, ResourcePool &pool) const
+{
+    const GLuint texture = pool.acquireTexture(state, mFormat.internalFormat(),
+                                               mFormat.uploadWidth(), mFormat.uploadHeight());
+    // pooled textures may come with the swizzle of another user
+    static const GLint identity[] = {GL_RED, GL_GREEN, GL_BLUE, GL_ALPHA};
+    const GLint *swizzle = mFormat.swizzle();
+    state.textureSwizzle(texture, swizzle ? swizzle : identity);
+    return texture;
+}
+
+size_t UploadPipeline::framePitch() const
+{
+    return UploadArena::rowPitch(mFormat.rowBytes(), mFormat.texelBytes());
+}
+
+void UploadPipeline::stageFrame(uint8_t *dst, const uint8_t *src) const
+{
+    const size_t pitch = framePitch();
+    if (mFormat.pixelFormat == PixelFormat::RGBA16F) {
+        // the conversion is the copy, every value is read and written once
+        const size_t values = static_cast<size_t>(mFormat.width) * 4;
+        for (uint32_t row = 0; row < mFormat.uploadHeight(); ++row) {
+            const uint8_t *srcRow = src + row * mFormat.sourceRowBytes();
+            convertToHalf(reinterpret_cast<const float *>(srcRow), dst + row * pitch, values);
+        }
+        return;
+    }
+    copyRows(dst, pitch, src, mFormat.rowBytes(), mFormat.rowBytes(), mFormat.uploadHeight());
+}
+
+void UploadPipeline::setUnpackLayout(GlState &state) const
+{
+    state.pixelStore(GL_UNPACK_ALIGNMENT, 1);
+    const size_t rowLength = framePitch() / mFormat.texelBytes();
+    state.pixelStore(GL_UNPACK_ROW_LENGTH, static_cast<GLint>(rowLength));
+}
+
+void UploadPipeline::uploadFrame(GlState &state, GLuint texture, GLintptr offset) const
+{
+    state.texSubImage2D(texture, mFormat.uploadWidth(), mFormat.uploadHeight(), mFormat.glFormat(),
+                        mFormat.glType(), reinterpret_cast<const void *>(offset));
+}
+
+void UploadPipeline::printFootprint(uint32_t stagingFrames) const
+{
+    const double mb = 1024.0 * 1024.0;
+    const double textures = static_cast<double>(texturesCount) * mFormat.uploadWidth()
+                            * mFormat.uploadHeight()
+                            * ResourcePool::formatBytes(mFormat.internalFormat()) / mb;
+    const double staging = static_cast<double>(stagingFrames) * stagedFrameBytes() / mb;
+    printf("GPU memory per %s stream: %u textures %.1f MB + %u staging frames %.1f MB = %.1f MB, "
+           "%.1f MB for %u streams\n",
+           pixelFormatName(mFormat.pixelFormat), texturesCount, textures, stagingFrames, staging,
+           textures + staging, (textures + staging) * mStreams, mStreams);
+}
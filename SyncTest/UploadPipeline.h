@@ -0,0 +1,109 @@
+#ifndef UPLOADPIPELINE_H
+#define UPLOADPIPELINE_H
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "SDL2/SDL.h"
+#include "glad/gl.h"
+
+#include "FrameSource.h"
+#include "PixelFormat.h"
+#include "TimingStats.h"
+
+class GlState;
+class ResourcePool;
+
+// one frame of every stream
+struct FrameSlot
+{
+    // layer textures in stream order
+    std::vector<GLuint> textures;
+};
+
+struct UploadTimings
+{
+    // CPU time to produce one frame of all streams
+    TimingStats cpu;
+    // GPU time of the texture uploads of one frame
+    TimingStats gpu;
+};
+
+struct GlContexts
+{
+    SDL_Window *window = nullptr;
+    SDL_GLContext main = nullptr;
+    SDL_GLContext parallel = nullptr;
+    // binding caches of the contexts
+    GlState *mainState = nullptr;
+    GlState *parallelState = nullptr;
+};
+
+enum class UploadContext {
+    Main,
+    Parallel,
+};
+
+// Streams generated frames into textures that the render context samples.
+// Startup is split so it can overlap with the rest of initialization: prepare() is CPU only,
+// allocate() creates the GL objects on uploadContext(), start() launches the producer.
+// Everything else is called on the render thread with the main context current.
+class UploadPipeline
+{
+public:
+    // frames of every stream come from source, which has to outlive the pipeline
+    UploadPipeline(uint32_t streams, FrameSource &source)
+        : mStreams(streams), mSource(source), mFormat(source.format())
+    {}
+    virtual ~UploadPipeline() = default;
+
+    virtual const char *name() const = 0;
+    virtual UploadContext uploadContext() const = 0;
+    const FrameFormat &format() const { return mFormat; }
+
+    // generates the first frame of every stream, may run on any thread
+    void prepare();
+    // called with uploadContext() current on any thread, state is the one of that context;
+    // GL objects come from pool and go back to it when the pipeline is destroyed
+    virtual void allocate(GlState &state, ResourcePool &pool) = 0;
+    // called on the render thread after prepare() and allocate()
+    virtual void start(const GlContexts &contexts) = 0;
+
+    // blocks until the next frame can be sampled on the main context, one texture per stream
+    virtual const std::vector<GLuint> &acquireFrame() = 0;
+    // the frame returned by acquireFrame() was submitted for drawing
+    virtual void releaseFrame() = 0;
+    // layer of the frame of stream if acquireFrame() returned array textures, -1 for 2D ones
+    virtual GLint layer(uint32_t /*stream*/) const { return -1; }
+
+    virtual UploadTimings timings() const = 0;
+    virtual void printStats() const {}
+
+protected:
+    // ring texture for one stream, with the swizzle of the format applied
+    GLuint acquireTexture(GlState &state, ResourcePool &pool) const;
+    // bytes between rows and of a whole frame in the upload arena
+    size_t framePitch() const;
+    GLsizeiptr stagedFrameBytes() const { return framePitch() * mFormat.uploadHeight(); }
+    // copies a frame as the producer wrote it, sourceRowBytes() apart, into staging memory
+    // laid out with framePitch(), converting it to the uploaded format on the way
+    void stageFrame(uint8_t *dst, const uint8_t *src) const;
+    // unpack state for frames laid out with framePitch()
+    void setUnpackLayout(GlState &state) const;
+    // copies a staged frame at offset into the bound unpack buffer to texture
+    void uploadFrame(GlState &state, GLuint texture, GLintptr offset) const;
+    // GPU memory per stream of texturesCount textures and stagingFrames staged frames
+    void printFootprint(uint32_t stagingFrames) const;
+    // moves out the frame prepared for stream, empty once taken or if prepare() was not called
+    std::unique_ptr<uint8_t[]> takePreparedFrame(uint32_t stream);
+
+    const uint32_t mStreams = 1;
+    FrameSource &mSource;
+    const FrameFormat mFormat;
+
+private:
+    std::vector<std::unique_ptr<uint8_t[]>> mPreparedFrames;
+};
+
+#endif // UPLOADPIPELINE_H
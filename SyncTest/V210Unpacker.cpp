@@ -0,0 +1,92 @@
+#include "V210Unpacker.h"
+
+#include <cstdio>
+#include <cstdlib>
+
+#include "GlState.h"
+#include "ProgramCache.h"
+
+namespace {
+// one invocation per group of six pixels
+const GLuint groupPixels = 6;
+const GLuint localSizeX = 8;
+const GLuint localSizeY = 8;
+
+const char *computeShader = R"(
+#version 430 core
+layout(local_size_x = 8, local_size_y = 8) in;
+layout(binding = 0) uniform usampler2D words;
+layout(binding = 0, rgb10_a2) writeonly uniform image2D image;
+
+uint field(uint word, int index)
+{
+    return (word >> (10 * index)) & 0x3ffu;
+}
+
+vec4 rgb(uint y, uint cb, uint cr)
+{
+    // BT.709, video range
+    float luma = (float(y) - 64.0) / 876.0;
+    float blue = (float(cb) - 512.0) / 896.0;
+    float red = (float(cr) - 512.0) / 896.0;
+    return vec4(clamp(vec3(luma + 1.5748 * red,
+                           luma - 0.1873 * blue - 0.4681 * red,
+                           luma + 1.8556 * blue), 0.0, 1.0), 1.0);
+}
+
+void store(int x, int y, vec4 color)
+{
+    if (x < imageSize(image).x) {
+        imageStore(image, ivec2(x, y), color);
+    }
+}
+
+void main() {
+    ivec2 group = ivec2(gl_GlobalInvocationID.xy);
+    if (group.x * 6 >= imageSize(image).x || group.y >= imageSize(image).y) {
+        return;
+    }
+    // Cb0 Y0 Cr0 | Y1 Cb2 Y2 | Cr2 Y3 Cb4 | Y4 Cr4 Y5
+    uvec4 w = texelFetch(words, group, 0);
+    uint cb0 = field(w.x, 0), cr0 = field(w.x, 2);
+    uint cb2 = field(w.y, 1), cr2 = field(w.z, 0);
+    uint cb4 = field(w.z, 2), cr4 = field(w.w, 1);
+    int x = group.x * 6;
+    store(x, group.y, rgb(field(w.x, 1), cb0, cr0));
+    store(x + 1, group.y, rgb(field(w.y, 0), cb0, cr0));
+    store(x + 2, group.y, rgb(field(w.y, 2), cb2, cr2));
+    store(x + 3, group.y, rgb(field(w.z, 1), cb2, cr2));
+    store(x + 4, group.y, rgb(field(w.w, 0), cb4, cr4));
+    store(x + 5, group.y, rgb(field(w.w, 2), cb4, cr4));
+}
+)";
+} // namespace
+
+V210Unpacker::V210Unpacker(ProgramCache &programCache, GlState &state,
+                           const FrameFormat &format)
+    : mState(state), mFormat(format)
+{
+    if (!GLAD_GL_VERSION_4_3) {
+        printf("v210 frames need OpenGL 4.3 compute shaders\n");
+        exit(1);
+    }
+    mProgram = programCache.build("v210-unpack", {{GL_COMPUTE_SHADER, computeShader}});
+}
+
+V210Unpacker::~V210Unpacker()
+{
+    glDeleteProgram(mProgram);
+    mState.invalidate();
+}
+
+void V210Unpacker::unpack(GLuint source, GLuint target)
+{
+    mState.useProgram(mProgram);
+    mState.bindTexture(0, source);
+    glBindImageTexture(0, target, 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_RGB10_A2);
+    const GLuint groups = (mFormat.width + groupPixels - 1) / groupPixels;
+    glDispatchCompute((groups + localSizeX - 1) / localSizeX,
+                      (mFormat.height + localSizeY - 1) / localSizeY, 1);
+    // the draws that follow sample the image
+    glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT);
+}
@@ -0,0 +1,31 @@
+#ifndef V210UNPACKER_H
+#define V210UNPACKER_H
+
+#include "glad/gl.h"
+
+#include "PixelFormat.h"
+
+class GlState;
+class ProgramCache;
+
+// Converts v210 frames to RGB on the GPU. The raw words are uploaded unchanged into an
+// RGBA32UI texture, one texel per six pixels; a compute shader reads them with texelFetch and
+// writes BT.709 video range converted RGB into an RGB10_A2 image, keeping all ten bits.
+// Needs OpenGL 4.3, used on the main context only.
+class V210Unpacker
+{
+public:
+    // exits without compute shader support
+    V210Unpacker(ProgramCache &programCache, GlState &state, const FrameFormat &format);
+    ~V210Unpacker();
+
+    // source holds a frame in format, target is an RGB10_A2 texture of its size
+    void unpack(GLuint source, GLuint target);
+
+private:
+    GlState &mState;
+    FrameFormat mFormat;
+    GLuint mProgram = 0;
+};
+
+#endif // V210UNPACKER_H
@@ -0,0 +1,149 @@
+#include "VramClipUpload.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <memory>
+#include <unordered_map>
+
+#include "SDL2/SDL_timer.h"
+
+#include "GlState.h"
+#include "ResourcePool.h"
+
+VramClipUpload::VramClipUpload(const Options &options, FrameSource &source)
+    : UploadPipeline(options.streams, source),
+      mBudget(uint64_t{options.vramBudgetMegabytes} << 20), mTextures(options.streams),
+      mStreamLayers(options.streams)
+{
+    if (mFormat.pixelFormat == PixelFormat::V210) {
+        mUnsupported = "v210 frames are unpacked from 2D textures";
+        return;
+    }
+
+    // every stream walks its loop until it comes back to its first frame, clip frames that
+    // streams share get one layer
+    const uint64_t maxLayers = mBudget / layerBytes();
+    std::unordered_map<uint64_t, uint32_t> layers;
+    for (uint32_t stream = 0; stream < mStreams; ++stream) {
+        std::vector<uint32_t> &loop = mLoops.emplace_back();
+        uint64_t first = 0;
+        if (!mSource.clipFrame(stream, 0, first)) {
+            mUnsupported = "the source does not loop";
+            return;
+        }
+        for (uint64_t frame = 0;; ++frame) {
+            uint64_t index = first;
+            if (frame) {
+                mSource.clipFrame(stream, frame, index);
+                if (index == first) {
+                    break;
+                }
+            }
+            const auto [found, added] =
+                layers.try_emplace(index, static_cast<uint32_t>(mLoads.size()));
+            if (added) {
+                mLoads.push_back({stream, frame});
+            }
+            loop.push_back(found->second);
+            // a loop longer than the budget cannot close within it either
+            if (mLoads.size() > maxLayers || loop.size() > maxLayers) {
+                mUnsupported = "the clip exceeds the VRAM budget";
+                return;
+            }
+        }
+    }
+}
+
+VramClipUpload::~VramClipUpload()
+{
+    for (const GLuint array : mArrays) {
+        mState->deleteTexture(array);
+    }
+}
+
+void VramClipUpload::allocate(GlState &state, ResourcePool & /*pool*/)
+{
+    mState = &state;
+    // clips longer than the array size limit are split over several arrays
+    GLint maxLayers = 0;
+    glGetIntegerv(GL_MAX_ARRAY_TEXTURE_LAYERS, &maxLayers);
+    const auto layers = static_cast<GLint>(mLoads.size());
+    mArrayLayers = std::min(std::max(maxLayers, 1), layers);
+    for (GLint first = 0; first < layers; first += mArrayLayers) {
+        const GLsizei count = std::min(mArrayLayers, layers - first);
+        const GLuint array = state.createTextureArray(mFormat.internalFormat(),
+                                                      mFormat.uploadWidth(),
+                                                      mFormat.uploadHeight(), count);
+        if (const GLint *swizzle = mFormat.swizzle()) {
+            state.textureSwizzle(array, swizzle, GL_TEXTURE_2D_ARRAY);
+        }
+        mArrays.push_back(array);
+    }
+}
+
+void VramClipUpload::start(const GlContexts & /*contexts*/)
+{
+    // the frames are loaded here, after prepare() is done with the source
+    const uint64_t loadStart = SDL_GetPerformanceCounter();
+    GlState &state = *mState;
+    const auto layers = static_cast<GLint>(mLoads.size());
+    // a one-time load, staged in client memory instead of an arena
+    setUnpackLayout(state);
+    state.bindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    std::vector<uint8_t> staged(stagedFrameBytes());
+    std::vector<uint8_t> produced(mFormat.sourceFrameBytes());
+    std::vector<std::unique_ptr<uint8_t[]>> prepared;
+    for (uint32_t i = 0; i < mStreams; ++i) {
+        prepared.push_back(takePreparedFrame(i));
+    }
+    for (GLint layer = 0; layer < layers; ++layer) {
+        const Load &load = mLoads[layer];
+        const uint8_t *data = nullptr;
+        if (!load.frame && prepared[load.stream]) {
+            data = prepared[load.stream].get();
+        } else if (!(data = mSource.frameData(load.stream, load.frame))) {
+            mSource.readFrame(load.stream, load.frame, produced.data(), mFormat.sourceRowBytes());
+            data = produced.data();
+        }
+        stageFrame(staged.data(), data);
+        state.texSubImage3D(mArrays[layer / mArrayLayers], layer % mArrayLayers,
+                            mFormat.uploadWidth(), mFormat.uploadHeight(), mFormat.glFormat(),
+                            mFormat.glType(), staged.data());
+    }
+    // the load is done before the first frame, not spread over the first loop
+    glFinish();
+    mLoadMs = (SDL_GetPerformanceCounter() - loadStart) * 1000.0 / SDL_GetPerformanceFrequency();
+}
+
+const std::vector<GLuint> &VramClipUpload::acquireFrame()
+{
+    const uint64_t start = SDL_GetPerformanceCounter();
+    for (uint32_t i = 0; i < mStreams; ++i) {
+        const std::vector<uint32_t> &loop = mLoops[i];
+        const uint32_t layer = loop[mFrame % loop.size()];
+        mTextures[i] = mArrays[layer / mArrayLayers];
+        mStreamLayers[i] = static_cast<GLint>(layer % mArrayLayers);
+    }
+    mTimings.cpu.add((SDL_GetPerformanceCounter() - start) * 1000.0
+                     / SDL_GetPerformanceFrequency());
+    return mTextures;
+}
+
+void VramClipUpload::releaseFrame()
+{
+    mFrame++;
+}
+
+void VramClipUpload::printStats() const
+{
+    printf("VRAM clip: %zu frames in %zu array textures, %.1f MB of %.1f MB budget, loaded in "
+           "%.1f ms\n",
+           mLoads.size(), mArrays.size(), mLoads.size() * layerBytes() / 1048576.0,
+           mBudget / 1048576.0, mLoadMs);
+}
+
+uint64_t VramClipUpload::layerBytes() const
+{
+    return uint64_t{mFormat.uploadWidth()} * mFormat.uploadHeight()
+           * ResourcePool::formatBytes(mFormat.internalFormat());
+}
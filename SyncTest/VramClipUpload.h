@@ -0,0 +1,66 @@
+#ifndef VRAMCLIPUPLOAD_H
+#define VRAMCLIPUPLOAD_H
+
+#include <cstdint>
+#include <vector>
+
+#include "Options.h"
+#include "UploadPipeline.h"
+
+// Keeps a short loop resident in video memory: every frame of the clip that a stream shows is
+// uploaded once into a layer of GL_TEXTURE_2D_ARRAY textures when the pipeline is started,
+// playback then only selects the layer of every stream and uploads nothing. The layers are
+// found by following FrameSource::clipFrame() of every stream until its loop closes. Sources
+// that do not loop, v210 frames, which are unpacked from 2D textures, and clips above the
+// budget are not supported; createPipeline() streams them instead.
+class VramClipUpload : public UploadPipeline
+{
+public:
+    VramClipUpload(const Options &options, FrameSource &source);
+    ~VramClipUpload() override;
+
+    const char *name() const override { return "vram"; }
+    UploadContext uploadContext() const override { return UploadContext::Main; }
+    // null if the clip fits, otherwise why it cannot be held
+    const char *unsupported() const { return mUnsupported; }
+
+    void allocate(GlState &state, ResourcePool &pool) override;
+    // uploads the clip, blocking until it is resident
+    void start(const GlContexts &contexts) override;
+
+    const std::vector<GLuint> &acquireFrame() override;
+    void releaseFrame() override;
+    GLint layer(uint32_t stream) const override { return mStreamLayers[stream]; }
+
+    UploadTimings timings() const override { return mTimings; }
+    void printStats() const override;
+
+private:
+    // frame of a stream that shows a clip frame, produced to fill its layer
+    struct Load
+    {
+        uint32_t stream = 0;
+        uint64_t frame = 0;
+    };
+
+    // bytes of one layer
+    uint64_t layerBytes() const;
+
+    const uint64_t mBudget = 0;
+    const char *mUnsupported = nullptr;
+    // clip layer of every frame of a loop, per stream
+    std::vector<std::vector<uint32_t>> mLoops;
+    std::vector<Load> mLoads;
+
+    GlState *mState = nullptr;
+    std::vector<GLuint> mArrays;
+    GLint mArrayLayers = 0;
+    double mLoadMs = 0;
+
+    uint64_t mFrame = 0;
+    std::vector<GLuint> mTextures;
+    std::vector<GLint> mStreamLayers;
+    UploadTimings mTimings;
+};
+
+#endif // VRAMCLIPUPLOAD_H
@@ -0,0 +1,226 @@
+#include "WarpStage.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+
+#include "GlState.h"
+#include "ProgramCache.h"
+
+namespace {
+const GLsizei maskWidth = 512;
+// projectors emit roughly gamma 2.2 light, the ramps have to sum to one in linear light
+const float projectorGamma = 2.2f;
+
+const char *vertexShader = R"(
+#version 330 core
+layout(location=0)in vec2 position;
+layout(location=1)in vec2 gridPos;
+// x offset and width of the output slice in the source
+uniform vec2 sourceRect;
+out vec2 sourcePos;
+out vec2 maskPos;
+void main() {
+    gl_Position = vec4(position, 0, 1);
+    sourcePos = vec2(sourceRect.x + gridPos.x * sourceRect.y, gridPos.y);
+    maskPos = gridPos;
+}
+)";
+
+const char *fragmentShader = R"(
+#version 330 core
+layout(location=0)out vec4 res;
+uniform sampler2D source;
+uniform sampler2D mask;
+in vec2 sourcePos;
+in vec2 maskPos;
+void main() {
+    res = texture(source, sourcePos) * texture(mask, maskPos).r;
+}
+)";
+
+// weight of an output at t across its overlap, t = 0 at the far edge
+float blendRamp(float t)
+{
+    const float linear = t * t * (3 - 2 * t);
+    return std::pow(linear, 1 / projectorGamma);
+}
+} // namespace
+
+WarpStage::WarpStage(ProgramCache &programCache, GlState &state, uint32_t outputs,
+                     float overlap, int width, int height)
+    : mState(state), mWidth(width), mHeight(height)
+{
+    mProgram = programCache.build("warp", {{GL_VERTEX_SHADER, vertexShader},
+                                           {GL_FRAGMENT_SHADER, fragmentShader}});
+    mSourceRectLocation = glGetUniformLocation(mProgram, "sourceRect");
+    mState.useProgram(mProgram);
+    glUniform1i(glGetUniformLocation(mProgram, "source"), 0);
+    glUniform1i(glGetUniformLocation(mProgram, "mask"), 1);
+
+    std::vector<GLuint> indices;
+    const uint32_t rowVertices = gridColumns + 1;
+    for (uint32_t row = 0; row < gridRows; ++row) {
+        for (uint32_t column = 0; column < gridColumns; ++column) {
+            const GLuint corner = row * rowVertices + column;
+            indices.insert(indices.end(), {corner, corner + 1, corner + rowVertices,
+                                           corner + 1, corner + rowVertices + 1,
+                                           corner + rowVertices});
+        }
+    }
+    mIndexCount = static_cast<GLsizei>(indices.size());
+    // not created as GL_ELEMENT_ARRAY_BUFFER, that binding belongs to whatever VAO is bound
+    mIndexBuffer = mState.createBuffer(GL_COPY_WRITE_BUFFER,
+                                       static_cast<GLsizeiptr>(indices.size() * sizeof(GLuint)),
+                                       indices.data(), 0);
+
+    mOutputs.resize(outputs);
+    for (uint32_t i = 0; i < outputs; ++i) {
+        createOutput(mOutputs[i], i, overlap);
+    }
+    printf("Warp: %u outputs, %.0f%% overlap, %ux%u grid\n", outputs, overlap * 100,
+           gridColumns, gridRows);
+}
+
+WarpStage::~WarpStage()
+{
+    for (auto &output : mOutputs) {
+        glDeleteVertexArrays(1, &output.vertexArray);
+        mState.deleteBuffer(output.vertexBuffer);
+        mState.deleteTexture(output.mask);
+    }
+    mState.deleteBuffer(mIndexBuffer);
+    glDeleteProgram(mProgram);
+    mState.invalidate();
+}
+
+void WarpStage::createOutput(Output &output, uint32_t index, float overlap)
+{
+    const uint32_t count = outputs();
+    output.sourceScale = 1 / (count - (count - 1) * overlap);
+    output.sourceOffset = index * output.sourceScale * (1 - overlap);
+
+    for (uint32_t row = 0; row <= gridRows; ++row) {
+        for (uint32_t column = 0; column <= gridColumns; ++column) {
+            Vertex vertex;
+            vertex.u = static_cast<float>(column) / gridColumns;
+            vertex.v = static_cast<float>(row) / gridRows;
+            vertex.x = vertex.u * 2 - 1;
+            vertex.y = vertex.v * 2 - 1;
+            output.vertices.push_back(vertex);
+        }
+    }
+    const GLsizeiptr verticesSize = static_cast<GLsizeiptr>(output.vertices.size()
+                                                            * sizeof(Vertex));
+    output.vertexBuffer = mState.createBuffer(GL_ARRAY_BUFFER, verticesSize,
+                                              output.vertices.data(), GL_DYNAMIC_STORAGE_BIT);
+
+    if (mState.directStateAccess()) {
+        glCreateVertexArrays(1, &output.vertexArray);
+        glVertexArrayVertexBuffer(output.vertexArray, 0, output.vertexBuffer, 0, sizeof(Vertex));
+        glVertexArrayElementBuffer(output.vertexArray, mIndexBuffer);
+        for (GLuint attrib = 0; attrib < 2; ++attrib) {
+            glEnableVertexArrayAttrib(output.vertexArray, attrib);
+            glVertexArrayAttribFormat(output.vertexArray, attrib, 2, GL_FLOAT, GL_FALSE,
+                                      attrib * 2 * sizeof(float));
+            glVertexArrayAttribBinding(output.vertexArray, attrib, 0);
+        }
+    } else {
+        glGenVertexArrays(1, &output.vertexArray);
+        mState.bindVertexArray(output.vertexArray);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mIndexBuffer);
+        mState.bindBuffer(GL_ARRAY_BUFFER, output.vertexBuffer);
+        glEnableVertexAttribArray(0);
+        glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), nullptr);
+        glEnableVertexAttribArray(1);
+        glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex),
+                              reinterpret_cast<void *>(2 * sizeof(float)));
+    }
+
+    // edges shared with a neighbour fade out across the overlap
+    std::vector<uint8_t> mask(maskWidth);
+    for (GLsizei i = 0; i < maskWidth; ++i) {
+        const float u = (i + 0.5f) / maskWidth;
+        float weight = 1;
+        if (index > 0 && u < overlap) {
+            weight *= blendRamp(u / overlap);
+        }
+        if (index + 1 < count && u > 1 - overlap) {
+            weight *= blendRamp((1 - u) / overlap);
+        }
+        mask[i] = static_cast<uint8_t>(std::lround(weight * 255));
+    }
+    output.mask = mState.createTexture(GL_R8, maskWidth, 1);
+    mState.bindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    mState.pixelStore(GL_UNPACK_ALIGNMENT, 1);
+    mState.texSubImage2D(output.mask, maskWidth, 1, GL_RED, GL_UNSIGNED_BYTE, mask.data());
+}
+
+void WarpStage::setVertex(uint32_t output, uint32_t column, uint32_t row, float x, float y)
+{
+    if (output >= outputs() || column > gridColumns || row > gridRows) {
+        printf("Warp vertex %u:%u,%u out of range\n", output, column, row);
+        exit(1);
+    }
+    Output &target = mOutputs[output];
+    Vertex &vertex = target.vertices[row * (gridColumns + 1) + column];
+    vertex.x = x;
+    vertex.y = y;
+    if (target.dirtyBegin >= target.dirtyEnd) {
+        target.dirtyBegin = row;
+        target.dirtyEnd = row + 1;
+    } else {
+        target.dirtyBegin = std::min(target.dirtyBegin, row);
+        target.dirtyEnd = std::max(target.dirtyEnd, row + 1);
+    }
+}
+
+void WarpStage::setKeystone(float amount)
+{
+    for (uint32_t output = 0; output < outputs(); ++output) {
+        for (uint32_t row = 0; row <= gridRows; ++row) {
+            const float v = static_cast<float>(row) / gridRows;
+            const float scale = 1 - amount * (1 - v);
+            for (uint32_t column = 0; column <= gridColumns; ++column) {
+                const float u = static_cast<float>(column) / gridColumns;
+                setVertex(output, column, row, (u * 2 - 1) * scale, v * 2 - 1);
+            }
+        }
+    }
+}
+
+void WarpStage::flush(Output &output)
+{
+    if (output.dirtyBegin >= output.dirtyEnd) {
+        return;
+    }
+    // rows are contiguous in the buffer, one upload covers the modified range
+    const size_t rowVertices = gridColumns + 1;
+    const size_t first = output.dirtyBegin * rowVertices;
+    const size_t count = (output.dirtyEnd - output.dirtyBegin) * rowVertices;
+    const GLsizeiptr size = static_cast<GLsizeiptr>(count * sizeof(Vertex));
+    mState.bufferSubData(GL_ARRAY_BUFFER, output.vertexBuffer,
+                         static_cast<GLintptr>(first * sizeof(Vertex)), size,
+                         &output.vertices[first]);
+    mUpdatedBytes += static_cast<uint64_t>(size);
+    output.dirtyBegin = output.dirtyEnd = 0;
+}
+
+void WarpStage::render(GLuint sourceTexture, int width, int height)
+{
+    mState.useProgram(mProgram);
+    mState.bindTexture(0, sourceTexture);
+    const int count = static_cast<int>(outputs());
+    for (int i = 0; i < count; ++i) {
+        Output &output = mOutputs[i];
+        flush(output);
+
+        const int x = width * i / count;
+        glViewport(x, 0, width * (i + 1) / count - x, height);
+        glUniform2f(mSourceRectLocation, output.sourceOffset, output.sourceScale);
+        mState.bindTexture(1, output.mask);
+        mState.bindVertexArray(output.vertexArray);
+        glDrawElements(GL_TRIANGLES, mIndexCount, GL_UNSIGNED_INT, nullptr);
+    }
+}
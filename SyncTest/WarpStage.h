@@ -0,0 +1,85 @@
+#ifndef WARPSTAGE_H
+#define WARPSTAGE_H
+
+#include <cstdint>
+#include <vector>
+
+#include "glad/gl.h"
+
+class GlState;
+class ProgramCache;
+
+// Geometric warp and soft-edge blend of projector outputs on the GPU. The source is rendered
+// offscreen first, then every output draws its horizontal slice of it through a warp grid,
+// multiplied by that output's blend mask: one draw per output. Neighbouring slices overlap by
+// a fraction of the slice width and ramp out across it. Grid vertices can be moved at any
+// time; only the rows touched since the last frame are uploaded again.
+// Used on the main context only.
+class WarpStage
+{
+public:
+    static constexpr uint32_t gridColumns = 64;
+    static constexpr uint32_t gridRows = 36;
+
+    // width x height is the source resolution
+    WarpStage(ProgramCache &programCache, GlState &state, uint32_t outputs, float overlap,
+              int width, int height);
+    ~WarpStage();
+
+    // resolution the source has to be drawn at
+    int sourceWidth() const { return mWidth; }
+    int sourceHeight() const { return mHeight; }
+
+    uint32_t outputs() const { return static_cast<uint32_t>(mOutputs.size()); }
+    // moves a grid vertex to x, y in normalized device coordinates of the output viewport
+    void setVertex(uint32_t output, uint32_t column, uint32_t row, float x, float y);
+    // narrows the bottom edge of every output by amount of its width, a projector tilt
+    void setKeystone(float amount);
+
+    // draws all outputs side by side into the bound framebuffer of width x height
+    void render(GLuint sourceTexture, int width, int height);
+
+    // vertex bytes uploaded after creation
+    uint64_t updatedBytes() const { return mUpdatedBytes; }
+
+private:
+    struct Vertex
+    {
+        float x = 0;
+        float y = 0;
+        // position in the output slice of the source, also the blend mask coordinate
+        float u = 0;
+        float v = 0;
+    };
+
+    struct Output
+    {
+        GLuint vertexArray = 0;
+        GLuint vertexBuffer = 0;
+        GLuint mask = 0;
+        // slice of the source sampled by this output
+        float sourceOffset = 0;
+        float sourceScale = 1;
+        std::vector<Vertex> vertices;
+        // rows modified since the last upload, empty when begin >= end
+        uint32_t dirtyBegin = 0;
+        uint32_t dirtyEnd = 0;
+    };
+
+    void createOutput(Output &output, uint32_t index, float overlap);
+    void flush(Output &output);
+
+    GlState &mState;
+    int mWidth = 0;
+    int mHeight = 0;
+
+    GLuint mProgram = 0;
+    GLint mSourceRectLocation = -1;
+    GLuint mIndexBuffer = 0;
+    GLsizei mIndexCount = 0;
+
+    std::vector<Output> mOutputs;
+    uint64_t mUpdatedBytes = 0;
+};
+
+#endif // WARPSTAGE_H
@@ -1,86 +1,78 @@
-#include <atomic>
-#include <condition_variable>
+#include <algorithm>
+#include <cmath>
 #include <cstdio>
 #include <memory>
-#include <mutex>
-#include <thread>
+#include <string>
+#include <utility>
 #include <vector>
 
 #include "SDL2/SDL.h"
 #include "SDL2/SDL_main.h"
 #include "glad/gl.h"
 
+#include "DebugOutput.h"
+#include "Frame.h"
+#include "FrameCache.h"
+#include "GlState.h"
+#include "GpuTimer.h"
+#include "ImageSequenceSource.h"
+#include "Options.h"
+#include "ProgramCache.h"
+#include "RawFileSource.h"
+#include "RenderGraph.h"
+#include "ResourcePool.h"
 #include "Shader.h"
+#include "SharedContextUpload.h"
+#include "ShmSource.h"
+#include "SingleContextUpload.h"
+#include "SocketSource.h"
+#include "StartupGraph.h"
+#include "SwapStats.h"
+#include "TileFormat.h"
+#include "TileSource.h"
+#include "V210Unpacker.h"
+#include "VramClipUpload.h"
+#include "WarpStage.h"
 
 namespace {
-const uint32_t texturesCount = 4;
-const uint32_t texWidth = 1920;
-const uint32_t texHeight = 1080;
-const uint32_t bpp = 4;
-const uint32_t dataSize = texWidth * texHeight * bpp;
-
-const uint32_t barsCount = 8;
-const uint32_t barPeriod = texWidth / barsCount;
-const uint32_t barWidth = barPeriod / 2;
-const uint32_t barMoveStep = 4;
-
-struct TextureBuffer
+struct RunResult
 {
-    GLuint pbo = 0;
-    GLuint texture = 0;
-    GLsync sync = 0;
+    RunResult(std::string name, int refreshRate)
+        : name(std::move(name)), swapStats(refreshRate)
+    {}
+
+    std::string name;
+    uint32_t frames = 0;
+    double seconds = 0;
+    // time the render thread spent waiting for the next uploaded frame
+    double acquireMs = 0;
+    SwapStats swapStats;
+    UploadTimings upload;
+    TimingStats renderGpu;
+    // calls made through the state caches during the run, skipped ones were redundant binds
+    uint64_t mainIssued = 0;
+    uint64_t mainSkipped = 0;
+    uint64_t uploadIssued = 0;
+    uint64_t uploadSkipped = 0;
 };
 
-void generateBars(uint8_t *data, size_t size, uint32_t offset)
+// what the render loop draws with, all on the main context
+struct Renderer
 {
-    for (uint32_t y = 0; y < texHeight; ++y) {
-        for (uint32_t x = 0; x < texWidth; ++x) {
-            const uint8_t value = ((x + offset) / barWidth % 2 == 0) ? 255 : 0;
-            const size_t index = (y * texWidth + x) * bpp;
-            for (uint32_t i = 0; i < bpp; ++i) {
-                data[index + i] = value;
-            }
-        }
-    }
-}
-
-std::vector<TextureBuffer> createBuffers() {
-    std::vector<TextureBuffer> result;
-    for (uint32_t i = 0; i < texturesCount; ++i) {
-        TextureBuffer buffer;
-
-        glGenTextures(1, &buffer.texture);
-        if (!buffer.texture) {
-            printf("glGenTextures failed\n");
-            exit(1);
-        }
-        glBindTexture(GL_TEXTURE_2D, buffer.texture);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, texWidth, texHeight, 0, GL_RGBA, GL_UNSIGNED_BYTE,
-                     0);
-        glBindTexture(GL_TEXTURE_2D, 0);
-
-        glGenBuffers(1, &buffer.pbo);
-        if (!buffer.pbo) {
-            printf("glGenBuffers failed\n");
-            exit(1);
-        }
-        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, buffer.pbo);
-        glBufferData(GL_PIXEL_UNPACK_BUFFER, texWidth * texHeight * 4, NULL, GL_STREAM_DRAW);
-        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
-
-        result.push_back(buffer);
-    }
-    return result;
-}
-
-void destroyBuffers(std::vector<TextureBuffer> buffers) {
-    for (const auto &buf : buffers) {
-        glDeleteTextures(1, &buf.texture);
-        glDeleteBuffers(1, &buf.pbo);
-    }
-}
+    SDL_Window *window = nullptr;
+    SDL_DisplayMode mode{};
+    Shader *shader = nullptr;
+    RenderGraph *graph = nullptr;
+    // converts v210 stream textures before they are drawn, null for other formats
+    V210Unpacker *unpacker = nullptr;
+    // projector correction, null when the streams are drawn straight to the window
+    WarpStage *warp = nullptr;
+    GlState *state = nullptr;
+    // state of the parallel context, only counters are read
+    GlState *parallelState = nullptr;
+    GlErrorCheck errorCheck = GlErrorCheck::Frame;
+    DebugOutput *debugOutput = nullptr;
+};
 
 bool processSdlEvents()
 {
@@ -100,188 +92,471 @@ bool processSdlEvents()
     return true;
 }
 
-} // namespace
-
-int main(int argc, char **argv)
+// generated bars unless a file is played, exits if the file does not match --upload-format;
+// frames go through cache unless it is null
+std::unique_ptr<FrameSource> createSource(const Options &options, FrameCache *cache)
 {
-    printf("Started\n");
-    if (SDL_Init(SDL_INIT_VIDEO) != 0) {
-        printf("SDL_Init failed: %s", SDL_GetError());
-        exit(1);
+    FrameFormat format;
+    format.width = options.sourceWidth ? options.sourceWidth : texWidth;
+    format.height = options.sourceHeight ? options.sourceHeight : texHeight;
+    std::unique_ptr<FrameSource> source;
+    if (options.source.empty()) {
+        // the bars are uploaded in the format they declare unless forced otherwise
+        format.pixelFormat = options.uploadFormat.value_or(barsFormat);
+        source = std::make_unique<BarsSource>(format, options.streams);
+    } else if (options.source.rfind("shm:", 0) == 0) {
+        source = std::make_unique<ShmSource>(options.source.substr(4), options.streams);
+    } else if (options.source.rfind("tcp:", 0) == 0 || options.source.rfind("unix:", 0) == 0) {
+        source = std::make_unique<SocketSource>(options.source, options.streams);
+    } else if (options.source.find('%') != std::string::npos) {
+        format.pixelFormat = options.uploadFormat.value_or(PixelFormat::RGBA8);
+        source = std::make_unique<ImageSequenceSource>(options.source, format, options.streams,
+                                                       options.readAhead);
+    } else if (isTileFile(options.source)) {
+        source = std::make_unique<TileSource>(options.source, options.streams,
+                                              options.decodeThreads);
+    } else {
+        format.pixelFormat = options.uploadFormat.value_or(PixelFormat::RGBA8);
+        source = std::make_unique<RawFileSource>(options.source, format, options.streams);
     }
-    SDL_GL_SetAttribute(SDL_GL_CONTEXT_PROFILE_MASK, SDL_GL_CONTEXT_PROFILE_CORE);
-
-    SDL_DisplayMode mode;
-    if (SDL_GetDesktopDisplayMode(0, &mode) != 0) {
-        printf("SDL_GetDesktopDisplayMode failed\n");
+    const PixelFormat declared = source->format().pixelFormat;
+    if (options.uploadFormat && *options.uploadFormat != declared) {
+        printf("%s holds %s frames, they cannot be uploaded as %s\n", options.source.c_str(),
+               pixelFormatName(declared), pixelFormatName(*options.uploadFormat));
         exit(1);
     }
-    printf("Desktop display mode: %i x %i @ %i\n", mode.w, mode.h, mode.refresh_rate);
-
-    auto *window = SDL_CreateWindow("Screenberry", 0, 0, mode.w, mode.h,
-                                    SDL_WINDOW_OPENGL | SDL_WINDOW_SHOWN | SDL_WINDOW_FULLSCREEN);
-    if (!window) {
-        printf("SDL_CreateWindow failed\n");
-        exit(1);
+    if (cache) {
+        source = std::make_unique<CachedSource>(std::move(source), *cache, options.streams);
     }
+    return source;
+}
 
-    SDL_GL_SetAttribute(SDL_GL_SHARE_WITH_CURRENT_CONTEXT, 1);
-
-    SDL_GLContext parallelContext = SDL_GL_CreateContext(window);
-    SDL_GLContext mainContext = SDL_GL_CreateContext(window);
-    if (!parallelContext || !mainContext) {
-        printf("SDL_GL_CreateContext failed\n");
-        exit(1);
+std::unique_ptr<UploadPipeline> createPipeline(UploadMode uploadMode, const Options &options,
+                                               FrameSource &source)
+{
+    switch (uploadMode) {
+    case UploadMode::SharedContext:
+        return std::make_unique<SharedContextUpload>(options, source);
+    case UploadMode::SingleContext:
+        return std::make_unique<SingleContextUpload>(options, source);
+    case UploadMode::VramClip: {
+        auto pipeline = std::make_unique<VramClipUpload>(options, source);
+        if (!pipeline->unsupported()) {
+            return pipeline;
+        }
+        printf("Streaming instead of holding the clip in VRAM: %s\n", pipeline->unsupported());
+        return std::make_unique<SharedContextUpload>(options, source);
     }
-
-    if (SDL_GL_SetSwapInterval(1) != 0) {
-        printf("SDL_GL_SetSwapInterval failed\n");
-        exit(1);
     }
+    return {};
+}
 
-    if (!gladLoadGL((GLADloadfunc)SDL_GL_GetProcAddress)) {
-        printf("gladLoadGL failed\n");
+// makes the GL context current on this thread, exits on failure
+void makeCurrent(SDL_Window *window, SDL_GLContext context)
+{
+    if (SDL_GL_MakeCurrent(window, context) != 0) {
+        printf("SDL_GL_MakeCurrent failed: %s\n", SDL_GetError());
         exit(1);
     }
+}
 
-    std::mutex mutex;
-    std::condition_variable cond;
-    bool parallelMadeCurrent = false;
-    std::atomic_bool finished = false;
-
-    std::vector<TextureBuffer> buffers;
-    bool buffersReady = false;
-
-    uint32_t readIndex = 0;
-    uint32_t writeIndex = 0;
+// startup of pipelines after the first one, which is started by the startup graph
+void startPipeline(UploadPipeline &pipeline, const GlContexts &contexts, ResourcePool &pool)
+{
+    pipeline.prepare();
+    if (pipeline.uploadContext() == UploadContext::Parallel) {
+        makeCurrent(contexts.window, contexts.parallel);
+        pipeline.allocate(*contexts.parallelState, pool);
+        makeCurrent(contexts.window, contexts.main);
+    } else {
+        pipeline.allocate(*contexts.mainState, pool);
+    }
+    pipeline.start(contexts);
+}
 
-    std::thread thread([window, parallelContext, &finished, &mutex, &cond, &parallelMadeCurrent,
-                        &buffers, &writeIndex, &readIndex, &buffersReady]() {
-        {
-            std::lock_guard guard(mutex);
-            SDL_GL_MakeCurrent(window, parallelContext);
-            parallelMadeCurrent = true;
-            cond.notify_all();
+// renders until the window is closed or maxFrames are presented, returns false on close;
+// startup gets the first presented frame marked on it
+bool runPipeline(UploadPipeline &pipeline, const Renderer &renderer, uint32_t maxFrames,
+                 RunResult &result, StartupGraph *startup)
+{
+    const SDL_DisplayMode &mode = renderer.mode;
+    const uint64_t ticksPerSecond = SDL_GetPerformanceFrequency();
+    const uint64_t start = SDL_GetPerformanceCounter();
+    uint64_t acquireTicks = 0;
+    const uint64_t mainIssued = renderer.state->issued();
+    const uint64_t mainSkipped = renderer.state->skipped();
+    const uint64_t uploadIssued = renderer.parallelState->issued();
+    const uint64_t uploadSkipped = renderer.parallelState->skipped();
+    GpuTimer renderTimer;
+    bool closed = false;
+    while (!maxFrames || result.frames < maxFrames) {
+        if (!processSdlEvents()) {
+            closed = true;
+            break;
         }
-        {
-            std::unique_lock lock(mutex);
-            while (!finished && !buffersReady) {
-                cond.wait(lock);
+
+        const uint64_t acquireStart = SDL_GetPerformanceCounter();
+        const auto &textures = pipeline.acquireFrame();
+        acquireTicks += SDL_GetPerformanceCounter() - acquireStart;
+
+        // with warping the streams are composed offscreen first, then one draw per output
+        RenderGraph &graph = *renderer.graph;
+        WarpStage *warp = renderer.warp;
+        graph.reset();
+        const auto backbuffer = graph.backbuffer(mode.w, mode.h);
+        const auto composed = warp ? graph.createTarget("composed", GL_RGBA8, warp->sourceWidth(),
+                                                        warp->sourceHeight())
+                                   : backbuffer;
+        // v210 streams are unpacked into transient RGB targets by compute passes first
+        std::vector<RenderGraph::Resource> unpacked;
+        if (V210Unpacker *unpacker = renderer.unpacker) {
+            const FrameFormat &format = pipeline.format();
+            for (size_t i = 0; i < textures.size(); ++i) {
+                const auto target = graph.createTarget("unpacked", GL_RGB10_A2, format.width,
+                                                       format.height);
+                const GLuint texture = textures[i];
+                graph.addPass("v210-unpack", {}, target,
+                              [unpacker, texture](const RenderGraph::Pass &pass) {
+                                  unpacker->unpack(texture, pass.output());
+                              });
+                unpacked.push_back(target);
             }
         }
-        auto data = std::make_unique<uint8_t[]>(dataSize);
-        uint32_t barsOffset = 0;
-        while (!finished) {
-            barsOffset = (barsOffset + barMoveStep) % barPeriod;
-            generateBars(data.get(), dataSize, barsOffset);
-
-            {
-                std::unique_lock lock(mutex);
-                while (!finished && writeIndex != readIndex) {
-                    cond.wait(lock);
+        graph.addPass("compose", unpacked, composed, [&](const RenderGraph::Pass &pass) {
+            // streams are laid out as a grid of equal tiles
+            const int layers = static_cast<int>(textures.size());
+            const int columns = static_cast<int>(std::ceil(std::sqrt(layers)));
+            const int rows = (layers + columns - 1) / columns;
+            for (int i = 0; i < layers; ++i) {
+                const int x = pass.width() * (i % columns) / columns;
+                const int y = pass.height() * (rows - 1 - i / columns) / rows;
+                glViewport(x, y, pass.width() * (i % columns + 1) / columns - x,
+                           pass.height() * (rows - i / columns) / rows - y);
+                if (unpacked.empty()) {
+                    renderer.shader->render(textures[i], pipeline.layer(i));
+                } else {
+                    renderer.shader->render(pass.texture(unpacked[i]));
                 }
             }
+        });
+        if (warp) {
+            graph.addPass("warp", {composed}, backbuffer, [&](const RenderGraph::Pass &pass) {
+                warp->render(pass.texture(composed), pass.width(), pass.height());
+            });
+        }
 
-            TextureBuffer &writebuffer = buffers[writeIndex];
+        renderTimer.begin();
+        graph.execute();
+        renderTimer.end();
 
-            glBindBuffer(GL_PIXEL_UNPACK_BUFFER, writebuffer.pbo);
-            auto mappedPtr = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, dataSize,
-                                              GL_MAP_WRITE_BIT);
-            glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+        SDL_GL_SwapWindow(renderer.window);
+        result.swapStats.onSwap();
+        if (startup && !result.frames) {
+            startup->mark("first frame presented");
+            startup->printTimeline();
+        }
 
-            std::memcpy(mappedPtr, data.get(), dataSize);
+        switch (renderer.errorCheck) {
+        case GlErrorCheck::Frame:
+            if (auto err = glGetError(); err != GL_NO_ERROR) {
+                printf("GL error: 0x%04x\n", err);
+                exit(1);
+            }
+            break;
+        case GlErrorCheck::Debug:
+            // counted by the debug callback, no driver round trip
+            if (renderer.debugOutput->errors()) {
+                renderer.debugOutput->stop();
+                printf("GL error reported by debug output\n");
+                exit(1);
+            }
+            break;
+        case GlErrorCheck::Off: break;
+        }
 
-            glBindBuffer(GL_PIXEL_UNPACK_BUFFER, writebuffer.pbo);
-            glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
-            glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+        pipeline.releaseFrame();
 
-            glBindTexture(GL_TEXTURE_2D, writebuffer.texture);
-            glBindBuffer(GL_PIXEL_UNPACK_BUFFER, writebuffer.pbo);
-            glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
-            glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, texWidth, texHeight, GL_RGBA, GL_UNSIGNED_BYTE,
-                            0);
-            glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
-            glBindTexture(GL_TEXTURE_2D, 0);
+        result.frames++;
+    }
+    result.seconds = static_cast<double>(SDL_GetPerformanceCounter() - start) / ticksPerSecond;
+    result.acquireMs = static_cast<double>(acquireTicks) * 1000.0 / ticksPerSecond;
+    renderTimer.collect();
+    result.renderGpu = renderTimer.stats();
+    renderTimer.destroy();
+    result.upload = pipeline.timings();
+    result.mainIssued = renderer.state->issued() - mainIssued;
+    result.mainSkipped = renderer.state->skipped() - mainSkipped;
+    result.uploadIssued = renderer.parallelState->issued() - uploadIssued;
+    result.uploadSkipped = renderer.parallelState->skipped() - uploadSkipped;
+    return !closed;
+}
 
-            writebuffer.sync = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
-            glFlush();
+// compares per-frame costs with the refresh period to tell what limits the frame rate
+void printTimings(const RunResult &result)
+{
+    printf("Frame timings:\n");
+    result.upload.cpu.print("upload cpu");
+    result.upload.gpu.print("upload gpu");
+    result.renderGpu.print("render gpu");
+    if (result.frames) {
+        printf("  GL state calls per frame: main %.1f issued, %.1f skipped; "
+               "upload %.1f issued, %.1f skipped\n",
+               static_cast<double>(result.mainIssued) / result.frames,
+               static_cast<double>(result.mainSkipped) / result.frames,
+               static_cast<double>(result.uploadIssued) / result.frames,
+               static_cast<double>(result.uploadSkipped) / result.frames);
+    }
 
-            {
-                std::lock_guard guard(mutex);
-                writeIndex = (writeIndex + 1) % texturesCount;
-                cond.notify_all();
-            }
-        }
-    });
+    const double period = result.swapStats.periodMs();
+    if (period <= 0) {
+        return;
+    }
+    struct Stage
     {
-        std::unique_lock lock(mutex);
-        while (!parallelMadeCurrent) {
-            cond.wait(lock);
+        const char *bound;
+        double ms;
+    };
+    const Stage stages[] = {
+        {"CPU", result.upload.cpu.averageMs()},
+        {"bus", result.upload.gpu.averageMs()},
+        {"GPU", result.renderGpu.averageMs()},
+    };
+    const Stage *worst = &stages[0];
+    for (const auto &stage : stages) {
+        if (stage.ms > worst->ms) {
+            worst = &stage;
         }
     }
+    // a stage close to the whole period leaves no headroom for driver and compositor work
+    if (worst->ms > period * 0.9) {
+        printf("  %s-bound: %.3f ms of %.3f ms frame period\n", worst->bound, worst->ms, period);
+    } else {
+        printf("  within budget: largest %s stage %.3f ms of %.3f ms frame period\n",
+               worst->bound, worst->ms, period);
+    }
+}
 
-    buffers = createBuffers();
-    {
-        std::lock_guard guard(mutex);
-        buffersReady = true;
-        cond.notify_all();
+void printComparison(const std::vector<RunResult> &results)
+{
+    printf("Upload mode comparison:\n");
+    printf("  %-8s %8s %9s %8s %8s %8s %12s\n", "mode", "frames", "fps", "on-time", "late",
+           "missed", "acquire ms");
+    for (const auto &result : results) {
+        const auto &stats = result.swapStats;
+        printf("  %-8s %8u %9.2f %8llu %8llu %8llu %12.3f\n", result.name.c_str(), result.frames,
+               result.seconds > 0 ? result.frames / result.seconds : 0.0,
+               static_cast<unsigned long long>(stats.onTime()),
+               static_cast<unsigned long long>(stats.late()),
+               static_cast<unsigned long long>(stats.missed()),
+               result.frames ? result.acquireMs / result.frames : 0.0);
     }
+}
 
-    auto shader = std::make_unique<Shader>();
-    uint32_t frame = 0;
-    while (true) {
-        if (!processSdlEvents()) {
-            break;
-        }
+} // namespace
 
-        {
-            std::unique_lock lock(mutex);
-            while (writeIndex == readIndex) {
-                cond.wait(lock);
-            }
-        }
+int main(int argc, char **argv)
+{
+    printf("Started\n");
+    const Options options = parseOptions(argc, argv);
 
-        TextureBuffer &readBuffer = buffers[readIndex];
+    std::vector<UploadMode> uploadModes = {options.uploadMode};
+    if (options.benchmark) {
+        uploadModes = {UploadMode::SharedContext, UploadMode::SingleContext,
+                       UploadMode::VramClip};
+    }
+    // the layers of resident clips are drawn with programs of their own
+    const bool textureArrays = std::find(uploadModes.begin(), uploadModes.end(),
+                                         UploadMode::VramClip) != uploadModes.end();
 
-        if (!readBuffer.sync) {
-            printf("Error: No sync\n");
+    SDL_DisplayMode mode;
+    GlContexts contexts;
+    Renderer renderer;
+    renderer.errorCheck = options.glErrorCheck;
+    std::unique_ptr<DebugOutput> debugOutput;
+    std::unique_ptr<GlState> mainState;
+    std::unique_ptr<GlState> parallelState;
+    ResourcePool resourcePool;
+    std::unique_ptr<ProgramCache> programCache;
+    std::unique_ptr<Shader> shader;
+    std::unique_ptr<WarpStage> warp;
+    std::unique_ptr<V210Unpacker> unpacker;
+    std::unique_ptr<RenderGraph> renderGraph;
+    // declared before the pipelines, which read from it until they are destroyed
+    std::unique_ptr<FrameCache> frameCache;
+    if (options.frameCacheMegabytes) {
+        frameCache = std::make_unique<FrameCache>(uint64_t{options.frameCacheMegabytes} << 20);
+    }
+    const auto source = createSource(options, frameCache.get());
+    const FrameFormat &frameFormat = source->format();
+    auto pipeline = createPipeline(uploadModes.front(), options, *source);
+    const bool parallelUpload = pipeline->uploadContext() == UploadContext::Parallel;
+
+    // window system work stays on the main thread, buffers are allocated on the upload context
+    // while the main context compiles shaders, first frames are generated from the start
+    StartupGraph startup;
+    startup.add("sdl-init", "main", {}, [&]() {
+        if (SDL_Init(SDL_INIT_VIDEO) != 0) {
+            printf("SDL_Init failed: %s", SDL_GetError());
             exit(1);
         }
-        glWaitSync(readBuffer.sync, 0, GL_TIMEOUT_IGNORED);
-        glDeleteSync(readBuffer.sync);
-        readBuffer.sync = nullptr;
-
-        glBindFramebuffer(GL_FRAMEBUFFER, 0);
-        glViewport(0, 0, mode.w, mode.h);
-
-        shader->render(readBuffer.texture);
-
-        SDL_GL_SwapWindow(window);
+        SDL_GL_SetAttribute(SDL_GL_CONTEXT_PROFILE_MASK, SDL_GL_CONTEXT_PROFILE_CORE);
+        if (options.glErrorCheck == GlErrorCheck::Debug) {
+            SDL_GL_SetAttribute(SDL_GL_CONTEXT_FLAGS, SDL_GL_CONTEXT_DEBUG_FLAG);
+        }
 
-        if (auto err = glGetError(); err != GL_NO_ERROR) {
-            printf("GL error: 0x%04x\n", err);
+        if (SDL_GetDesktopDisplayMode(0, &mode) != 0) {
+            printf("SDL_GetDesktopDisplayMode failed\n");
             exit(1);
         }
+        printf("Desktop display mode: %i x %i @ %i\n", mode.w, mode.h, mode.refresh_rate);
+    });
+    startup.add("window", "main", {"sdl-init"}, [&]() {
+        contexts.window = SDL_CreateWindow("Screenberry", 0, 0, mode.w, mode.h,
+                                           SDL_WINDOW_OPENGL | SDL_WINDOW_SHOWN
+                                               | SDL_WINDOW_FULLSCREEN);
+        if (!contexts.window) {
+            printf("SDL_CreateWindow failed\n");
+            exit(1);
+        }
+    });
+    startup.add("contexts", "main", {"window"}, [&]() {
+        SDL_GL_SetAttribute(SDL_GL_SHARE_WITH_CURRENT_CONTEXT, 1);
 
-        {
-            std::lock_guard guard(mutex);
-            readIndex = (readIndex + 1) % texturesCount;
-            cond.notify_all();
+        contexts.parallel = SDL_GL_CreateContext(contexts.window);
+        contexts.main = SDL_GL_CreateContext(contexts.window);
+        if (!contexts.parallel || !contexts.main) {
+            printf("SDL_GL_CreateContext failed\n");
+            exit(1);
         }
 
-        frame++;
+        if (SDL_GL_SetSwapInterval(1) != 0) {
+            printf("SDL_GL_SetSwapInterval failed\n");
+            exit(1);
+        }
+    });
+    startup.add("gl-load", "main", {"contexts"}, [&]() {
+        if (!gladLoadGL((GLADloadfunc)SDL_GL_GetProcAddress)) {
+            printf("gladLoadGL failed\n");
+            exit(1);
+        }
+        mainState = std::make_unique<GlState>();
+        parallelState = std::make_unique<GlState>();
+        contexts.mainState = mainState.get();
+        contexts.parallelState = parallelState.get();
+        printf("GL state: %s\n", mainState->directStateAccess() ? "direct state access"
+                                                                 : "bind to edit");
+    });
+    startup.add("debug-output", "main", {"gl-load"}, [&]() {
+        if (options.glErrorCheck != GlErrorCheck::Debug) {
+            return;
+        }
+        debugOutput = std::make_unique<DebugOutput>(
+            DebugOutput::Filter{options.glDebugMinSeverity, options.glDebugIgnoredIds});
+        makeCurrent(contexts.window, contexts.parallel);
+        const bool attached = debugOutput->attach("upload");
+        makeCurrent(contexts.window, contexts.main);
+        if (!attached || !debugOutput->attach("main")) {
+            printf("Falling back to glGetError every frame\n");
+            renderer.errorCheck = GlErrorCheck::Frame;
+        }
+        renderer.debugOutput = debugOutput.get();
+    });
+    startup.add("first-frame", "content", {}, [&]() { pipeline->prepare(); });
+    startup.add("shaders", "main", {"gl-load"}, [&]() {
+        std::string shaderCacheDir = options.shaderCache;
+        if (shaderCacheDir.empty()) {
+            if (char *prefPath = SDL_GetPrefPath("Screenberry", "SyncTest")) {
+                shaderCacheDir = std::string(prefPath) + "shaders";
+                SDL_free(prefPath);
+            }
+        } else if (shaderCacheDir == "off") {
+            shaderCacheDir.clear();
+        }
+        programCache = std::make_unique<ProgramCache>(shaderCacheDir);
+        shader = std::make_unique<Shader>(*programCache, *mainState, frameFormat, textureArrays);
+        renderGraph = std::make_unique<RenderGraph>(*mainState, resourcePool);
+        if (frameFormat.pixelFormat == PixelFormat::V210) {
+            unpacker = std::make_unique<V210Unpacker>(*programCache, *mainState, frameFormat);
+        }
+        if (options.outputs) {
+            warp = std::make_unique<WarpStage>(*programCache, *mainState, options.outputs,
+                                               options.blendOverlap / 100.0f, mode.w, mode.h);
+            if (options.warpKeystone) {
+                warp->setKeystone(options.warpKeystone / 100.0f);
+            }
+        }
+        programCache->printStats();
+    });
+    // debug output switches contexts on the main thread, it has to be done first
+    startup.add("buffers", parallelUpload ? "upload" : "main", {"gl-load", "debug-output"},
+                [&]() {
+                    if (parallelUpload) {
+                        makeCurrent(contexts.window, contexts.parallel);
+                    }
+                    pipeline->allocate(parallelUpload ? *parallelState : *mainState,
+                                      resourcePool);
+                    if (parallelUpload) {
+                        makeCurrent(contexts.window, nullptr);
+                    }
+                });
+    startup.add("upload-start", "main", {"first-frame", "shaders", "buffers"},
+                [&]() { pipeline->start(contexts); });
+    startup.run();
+
+    renderer.window = contexts.window;
+    renderer.mode = mode;
+    renderer.shader = shader.get();
+    renderer.warp = warp.get();
+    renderer.unpacker = unpacker.get();
+    renderer.graph = renderGraph.get();
+    renderer.state = mainState.get();
+    renderer.parallelState = parallelState.get();
+
+    std::vector<RunResult> results;
+    for (const auto uploadMode : uploadModes) {
+        RunResult &result = results.emplace_back(uploadModeName(uploadMode), mode.refresh_rate);
+        // the first pipeline was started by the startup graph
+        const bool first = pipeline != nullptr;
+        if (!first) {
+            pipeline = createPipeline(uploadMode, options, *source);
+            startPipeline(*pipeline, contexts, resourcePool);
+        }
+        // the vram mode may have fallen back to streaming
+        result.name = pipeline->name();
+        const bool completed = runPipeline(*pipeline, renderer, options.frames, result,
+                                           first ? &startup : nullptr);
+
+        printf("Rendered %i frames with %s upload\n", result.frames, result.name.c_str());
+        pipeline->printStats();
+        printTimings(result);
+        result.swapStats.print();
+        pipeline = {};
+        if (!completed) {
+            break;
+        }
     }
+    if (results.size() > 1) {
+        printComparison(results);
+    }
+    source->printStats();
+    renderGraph->printStats();
+    renderGraph = {};
+    resourcePool.printStats();
+    resourcePool.trim(*mainState);
+    unpacker = {};
+    warp = {};
     shader = {};
-    printf("Rendered %i frames\n", frame);
-    finished = true;
-    cond.notify_all();
-    thread.join();
-
-    destroyBuffers(std::move(buffers));
 
-    SDL_GL_DeleteContext(parallelContext);
-    SDL_GL_DeleteContext(mainContext);
-    SDL_DestroyWindow(window);
+    // drain while the contexts that call back are alive, their callbacks keep pointing at the
+    // output until they are deleted
+    if (debugOutput) {
+        debugOutput->stop();
+        debugOutput->printStats();
+    }
+    SDL_GL_DeleteContext(contexts.parallel);
+    SDL_GL_DeleteContext(contexts.main);
+    debugOutput = {};
+    SDL_DestroyWindow(contexts.window);
     SDL_Quit();
 
     printf("Finished\n");
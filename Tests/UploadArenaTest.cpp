@@ -0,0 +1,77 @@
+#include <cstdio>
+#include <deque>
+#include <utility>
+
+#include "UploadArena.h"
+
+namespace {
+int failures = 0;
+
+void check(bool condition, const char *what)
+{
+    if (!condition) {
+        printf("FAILED: %s\n", what);
+        failures++;
+    }
+}
+
+void testRowPitch()
+{
+    const size_t rgba8 = UploadArena::rowPitch(1920 * 4, 4);
+    check(rgba8 == 1920 * 4, "rgba8 rows of 7680 bytes are aligned already");
+
+    // rgb8 rows need a whole number of three-byte texels as well as the alignment
+    const size_t rgb8 = UploadArena::rowPitch(1366 * 3, 3);
+    check(rgb8 % UploadArena::alignment == 0, "rgb8 pitch is aligned");
+    check(rgb8 % 3 == 0, "rgb8 pitch is whole texels");
+    check(rgb8 >= 1366 * 3 && rgb8 < 1366 * 3 + 768, "rgb8 pitch pads less than 768 bytes");
+
+    const size_t r8 = UploadArena::rowPitch(1366, 1);
+    check(r8 == 1536, "r8 rows of 1366 bytes pad to 1536");
+}
+
+// count allocations of size have to be live at once in a ring of capacityFor(size, count),
+// and every further one has to fit once the oldest is retired
+void testCapacity(GLsizeiptr size, size_t count)
+{
+    const GLsizeiptr capacity = UploadArena::capacityFor(size, count);
+    std::deque<std::pair<GLintptr, GLintptr>> live;
+    for (int i = 0; i < 100; ++i) {
+        GLintptr offset = -1;
+        while ((offset = live.empty() ? UploadArena::findOffset(capacity, -1, -1, size)
+                                      : UploadArena::findOffset(capacity, live.front().first,
+                                                                live.back().second, size))
+               < 0) {
+            if (live.size() < count) {
+                printf("FAILED: %lld bytes: only %zu of %zu allocations fit %lld\n",
+                       static_cast<long long>(size), live.size(), count,
+                       static_cast<long long>(capacity));
+                failures++;
+                return;
+            }
+            live.pop_front();
+        }
+        check(offset % UploadArena::alignment == 0, "allocations start aligned");
+        live.emplace_back(offset, offset + size);
+    }
+}
+} // namespace
+
+int main()
+{
+    testRowPitch();
+    // frames of a multiple of the alignment, and sizes that leave padding after every one
+    const GLsizeiptr sizes[] = {256, 300, 1000, 1366 * 3 * 720, 4608 * 720 + 100};
+    const size_t counts[] = {1, 2, 3, 4, 8};
+    for (const GLsizeiptr size : sizes) {
+        for (const size_t count : counts) {
+            testCapacity(size, count);
+        }
+    }
+    if (failures) {
+        printf("%d checks failed\n", failures);
+        return 1;
+    }
+    printf("UploadArena: all checks passed\n");
+    return 0;
+}
@@ -0,0 +1,208 @@
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "Frame.h"
+#include "FrameSource.h"
+#include "PixelFormat.h"
+#include "RawFileSource.h"
+#include "ShmRing.h"
+#include "ShmSource.h"
+
+namespace {
+const uint32_t defaultSlots = 4;
+
+struct WriterOptions
+{
+    std::string name;
+    std::string input;
+    FrameFormat format;
+    uint32_t streams = 1;
+    uint32_t slots = defaultSlots;
+    // 0 writes as fast as the reader releases slots
+    uint32_t fps = 0;
+    // 0 writes until interrupted
+    uint64_t frames = 0;
+};
+
+// set by Ctrl+C, so the rings are removed on the way out
+volatile std::sig_atomic_t interrupted = 0;
+
+void onInterrupt(int /*signal*/)
+{
+    interrupted = 1;
+}
+
+void printUsage()
+{
+    printf("Usage: ShmWriter [options] NAME [INPUT]\n"
+           "  NAME                         writes rings NAME-0, NAME-1... for SyncTest\n"
+           "                               --source shm:NAME\n"
+           "  INPUT                        raw or Y4M file (default: generated bars)\n"
+           "  --format rgba8|rgb8|r8|mask1|v210|rgba16f|i420\n"
+           "                               format of raw input and bars (default rgba8)\n"
+           "  --size WxH                   frame size of raw input and bars (default %ux%u)\n"
+           "  --streams N                  rings written, one per stream (default 1)\n"
+           "  --slots N                    frames per ring (default %u)\n"
+           "  --fps N                      frames per second per stream (default: as fast as\n"
+           "                               the reader takes them)\n"
+           "  --frames N                   stop after N frames per stream (default: until\n"
+           "                               interrupted)\n",
+           texWidth, texHeight, defaultSlots);
+}
+
+uint32_t parseUint(const char *name, const char *value)
+{
+    char *end = nullptr;
+    const unsigned long result = strtoul(value, &end, 10);
+    if (!*value || *end) {
+        printf("Invalid value for %s: %s\n", name, value);
+        exit(1);
+    }
+    return static_cast<uint32_t>(result);
+}
+
+WriterOptions parseOptions(int argc, char **argv)
+{
+    WriterOptions options;
+    options.format.width = texWidth;
+    options.format.height = texHeight;
+    std::vector<std::string> names;
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        auto value = [&]() -> const char * {
+            if (i + 1 >= argc) {
+                printf("Missing value for %s\n", arg.c_str());
+                exit(1);
+            }
+            return argv[++i];
+        };
+
+        if (arg == "--format") {
+            const std::string format = value();
+            if (!parsePixelFormat(format, options.format.pixelFormat)) {
+                printf("Unknown format: %s\n", format.c_str());
+                exit(1);
+            }
+        } else if (arg == "--size") {
+            const char *size = value();
+            unsigned width = 0;
+            unsigned height = 0;
+            char end = 0;
+            if (sscanf(size, "%ux%u%c", &width, &height, &end) != 2 || !width || !height) {
+                printf("Invalid value for %s: %s\n", arg.c_str(), size);
+                exit(1);
+            }
+            options.format.width = width;
+            options.format.height = height;
+        } else if (arg == "--streams") {
+            options.streams = parseUint(arg.c_str(), value());
+            if (!options.streams) {
+                printf("At least one stream is needed\n");
+                exit(1);
+            }
+        } else if (arg == "--slots") {
+            options.slots = parseUint(arg.c_str(), value());
+            if (options.slots < 2) {
+                printf("A ring needs at least two slots, the reader holds one\n");
+                exit(1);
+            }
+        } else if (arg == "--fps") {
+            options.fps = parseUint(arg.c_str(), value());
+        } else if (arg == "--frames") {
+            options.frames = parseUint(arg.c_str(), value());
+        } else if (arg == "--help") {
+            printUsage();
+            exit(0);
+        } else if (arg.size() > 2 && arg.compare(0, 2, "--") == 0) {
+            printf("Unknown option: %s\n", arg.c_str());
+            printUsage();
+            exit(1);
+        } else {
+            names.push_back(arg);
+        }
+    }
+    if (names.empty() || names.size() > 2) {
+        printUsage();
+        exit(1);
+    }
+    options.name = names[0];
+    if (names.size() > 1) {
+        options.input = names[1];
+    }
+    return options;
+}
+} // namespace
+
+int main(int argc, char **argv)
+{
+    const WriterOptions options = parseOptions(argc, argv);
+    std::unique_ptr<FrameSource> source;
+    if (options.input.empty()) {
+        source = std::make_unique<BarsSource>(options.format, options.streams);
+    } else {
+        source = std::make_unique<RawFileSource>(options.input, options.format, options.streams);
+    }
+    const FrameFormat &format = source->format();
+    const size_t rowBytes = format.sourceRowBytes();
+
+    std::vector<std::unique_ptr<ShmRing>> rings;
+    for (uint32_t i = 0; i < options.streams; ++i) {
+        const std::string name = ShmSource::ringName(options.name, i);
+        rings.push_back(std::make_unique<ShmRing>(name, format, options.slots));
+    }
+    std::signal(SIGINT, onInterrupt);
+    printf("Writing %ux%u %s frames to %s, %u streams of %u slots; start SyncTest --source "
+           "shm:%s\n",
+           format.width, format.height, pixelFormatName(format.pixelFormat),
+           options.name.c_str(), options.streams, options.slots, options.name.c_str());
+
+    using Clock = std::chrono::steady_clock;
+    const auto start = Clock::now();
+    Clock::duration blocked{};
+    uint64_t frame = 0;
+    for (; !interrupted && (!options.frames || frame < options.frames); ++frame) {
+        if (options.fps) {
+            std::this_thread::sleep_until(start
+                                          + std::chrono::duration_cast<Clock::duration>(
+                                              std::chrono::duration<double>(
+                                                  static_cast<double>(frame) / options.fps)));
+        }
+        for (uint32_t i = 0; i < options.streams && !interrupted; ++i) {
+            // the frame is produced straight into the slot, no intermediate buffer
+            uint8_t *slot = rings[i]->writeSlot();
+            if (!slot) {
+                const auto waitStart = Clock::now();
+                while (!interrupted && !(slot = rings[i]->writeSlot())) {
+                    std::this_thread::sleep_for(std::chrono::microseconds(100));
+                }
+                blocked += Clock::now() - waitStart;
+                if (!slot) {
+                    break;
+                }
+            }
+            if (const uint8_t *data = source->frameData(i, frame)) {
+                copyRows(slot, rowBytes, data, rowBytes, rowBytes, format.uploadHeight());
+            } else {
+                source->readFrame(i, frame, slot, rowBytes);
+            }
+            rings[i]->publish();
+        }
+    }
+    const std::chrono::duration<double> seconds = Clock::now() - start;
+    const std::chrono::duration<double> blockedSeconds = blocked;
+
+    const double bytes = static_cast<double>(frame) * options.streams * format.sourceFrameBytes();
+    printf("Wrote %llu frames per stream in %.1f s: %.1f fps, %.1f MB/s, %.1f s waiting for "
+           "free slots\n",
+           static_cast<unsigned long long>(frame), seconds.count(),
+           seconds.count() > 0 ? frame / seconds.count() : 0.0,
+           seconds.count() > 0 ? bytes / 1e6 / seconds.count() : 0.0, blockedSeconds.count());
+    return 0;
+}
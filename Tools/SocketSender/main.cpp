@@ -0,0 +1,209 @@
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "Frame.h"
+#include "FrameSource.h"
+#include "PixelFormat.h"
+#include "RawFileSource.h"
+#include "SocketStream.h"
+
+namespace {
+struct SenderOptions
+{
+    std::string address;
+    std::string input;
+    FrameFormat format;
+    uint32_t streams = 1;
+    // 0 sends as fast as the player receives
+    uint32_t fps = 0;
+    // 0 sends until interrupted
+    uint64_t frames = 0;
+};
+
+// set by Ctrl+C, so a Unix socket file is removed on the way out
+volatile std::sig_atomic_t interrupted = 0;
+
+void onInterrupt(int /*signal*/)
+{
+    interrupted = 1;
+}
+
+void printUsage()
+{
+    printf("Usage: SocketSender [options] ADDRESS [INPUT]\n"
+           "  ADDRESS                      tcp:PORT, tcp:HOST:PORT or unix:PATH to listen on\n"
+           "                               for SyncTest --source ADDRESS\n"
+           "  INPUT                        raw or Y4M file (default: generated bars)\n"
+           "  --format rgba8|rgb8|r8|mask1|v210|rgba16f|i420\n"
+           "                               format of raw input and bars (default rgba8)\n"
+           "  --size WxH                   frame size of raw input and bars (default %ux%u)\n"
+           "  --streams N                  connections accepted, one per stream (default 1)\n"
+           "  --fps N                      frames per second per stream (default: as fast as\n"
+           "                               the player receives them)\n"
+           "  --frames N                   stop after N frames per stream (default: until\n"
+           "                               interrupted)\n",
+           texWidth, texHeight);
+}
+
+uint32_t parseUint(const char *name, const char *value)
+{
+    char *end = nullptr;
+    const unsigned long result = strtoul(value, &end, 10);
+    if (!*value || *end) {
+        printf("Invalid value for %s: %s\n", name, value);
+        exit(1);
+    }
+    return static_cast<uint32_t>(result);
+}
+
+SenderOptions parseOptions(int argc, char **argv)
+{
+    SenderOptions options;
+    options.format.width = texWidth;
+    options.format.height = texHeight;
+    std::vector<std::string> names;
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        auto value = [&]() -> const char * {
+            if (i + 1 >= argc) {
+                printf("Missing value for %s\n", arg.c_str());
+                exit(1);
+            }
+            return argv[++i];
+        };
+
+        if (arg == "--format") {
+            const std::string format = value();
+            if (!parsePixelFormat(format, options.format.pixelFormat)) {
+                printf("Unknown format: %s\n", format.c_str());
+                exit(1);
+            }
+        } else if (arg == "--size") {
+            const char *size = value();
+            unsigned width = 0;
+            unsigned height = 0;
+            char end = 0;
+            if (sscanf(size, "%ux%u%c", &width, &height, &end) != 2 || !width || !height) {
+                printf("Invalid value for %s: %s\n", arg.c_str(), size);
+                exit(1);
+            }
+            options.format.width = width;
+            options.format.height = height;
+        } else if (arg == "--streams") {
+            options.streams = parseUint(arg.c_str(), value());
+            if (!options.streams) {
+                printf("At least one stream is needed\n");
+                exit(1);
+            }
+        } else if (arg == "--fps") {
+            options.fps = parseUint(arg.c_str(), value());
+        } else if (arg == "--frames") {
+            options.frames = parseUint(arg.c_str(), value());
+        } else if (arg == "--help") {
+            printUsage();
+            exit(0);
+        } else if (arg.size() > 2 && arg.compare(0, 2, "--") == 0) {
+            printf("Unknown option: %s\n", arg.c_str());
+            printUsage();
+            exit(1);
+        } else {
+            names.push_back(arg);
+        }
+    }
+    if (names.empty() || names.size() > 2) {
+        printUsage();
+        exit(1);
+    }
+    options.address = names[0];
+    if (names.size() > 1) {
+        options.input = names[1];
+    }
+    return options;
+}
+} // namespace
+
+int main(int argc, char **argv)
+{
+    const SenderOptions options = parseOptions(argc, argv);
+    std::unique_ptr<FrameSource> source;
+    if (options.input.empty()) {
+        source = std::make_unique<BarsSource>(options.format, options.streams);
+    } else {
+        source = std::make_unique<RawFileSource>(options.input, options.format, options.streams);
+    }
+    const FrameFormat &format = source->format();
+    const size_t rowBytes = format.sourceRowBytes();
+
+    SocketListener listener(options.address);
+    std::signal(SIGINT, onInterrupt);
+    printf("Sending %ux%u %s frames on %s; start SyncTest --source %s --streams %u\n",
+           format.width, format.height, pixelFormatName(format.pixelFormat),
+           options.address.c_str(), options.address.c_str(), options.streams);
+    std::vector<std::unique_ptr<SocketStream>> connections;
+    for (uint32_t i = 0; i < options.streams; ++i) {
+        connections.push_back(listener.accept());
+        SocketStreamHeader header;
+        std::memcpy(header.magic, socketStreamMagic, sizeof(socketStreamMagic));
+        header.version = socketStreamVersion;
+        header.pixelFormat = static_cast<uint32_t>(format.pixelFormat);
+        header.width = format.width;
+        header.height = format.height;
+        const SocketBuffer buffer = {reinterpret_cast<uint8_t *>(&header), sizeof(header)};
+        if (!connections.back()->send(&buffer, 1)) {
+            printf("Stream %u closed before the first frame\n", i);
+            return 1;
+        }
+    }
+
+    using Clock = std::chrono::steady_clock;
+    const auto start = Clock::now();
+    Clock::duration sending{};
+    std::vector<uint8_t> produced(format.sourceFrameBytes());
+    bool closed = false;
+    uint64_t frame = 0;
+    for (; !interrupted && !closed && (!options.frames || frame < options.frames); ++frame) {
+        if (options.fps) {
+            std::this_thread::sleep_until(start
+                                          + std::chrono::duration_cast<Clock::duration>(
+                                              std::chrono::duration<double>(
+                                                  static_cast<double>(frame) / options.fps)));
+        }
+        for (uint32_t i = 0; i < options.streams && !closed; ++i) {
+            // frames in memory are sent from where they are
+            uint8_t *data = const_cast<uint8_t *>(source->frameData(i, frame));
+            if (!data) {
+                source->readFrame(i, frame, produced.data(), rowBytes);
+                data = produced.data();
+            }
+            const auto sendStart = Clock::now();
+            SocketFrameHeader header;
+            header.sequence = frame;
+            header.timestampNs = SocketStream::now();
+            const SocketBuffer buffers[] = {
+                {reinterpret_cast<uint8_t *>(&header), sizeof(header)},
+                {data, format.sourceFrameBytes()}};
+            if (!connections[i]->send(buffers, 2)) {
+                printf("The player closed stream %u\n", i);
+                closed = true;
+            }
+            sending += Clock::now() - sendStart;
+        }
+    }
+    const std::chrono::duration<double> seconds = Clock::now() - start;
+    const std::chrono::duration<double> sendingSeconds = sending;
+
+    const double bytes = static_cast<double>(frame) * options.streams * format.sourceFrameBytes();
+    printf("Sent %llu frames per stream in %.1f s: %.1f fps, %.1f MB/s, %.1f s blocked in "
+           "sends\n",
+           static_cast<unsigned long long>(frame), seconds.count(),
+           seconds.count() > 0 ? frame / seconds.count() : 0.0,
+           seconds.count() > 0 ? bytes / 1e6 / seconds.count() : 0.0, sendingSeconds.count());
+    return 0;
+}
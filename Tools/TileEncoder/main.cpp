@@ -0,0 +1,211 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "Frame.h"
+#include "FrameSource.h"
+#include "PixelFormat.h"
+#include "RawFileSource.h"
+#include "TileFormat.h"
+#include "TileSource.h"
+
+namespace {
+const uint32_t defaultTileRows = 64;
+const uint32_t defaultBarsFrames = 120;
+
+struct EncoderOptions
+{
+    std::string input;
+    std::string output;
+    FrameFormat format;
+    uint32_t tileRows = defaultTileRows;
+    // frames of generated bars, passes over the file when benchmarking
+    uint32_t frames = 0;
+    bool bench = false;
+};
+
+void printUsage()
+{
+    printf("Usage: TileEncoder [options] INPUT OUTPUT\n"
+           "       TileEncoder --bench FILE [--frames N]\n"
+           "  INPUT                        raw or Y4M file, or \"bars\" for generated bars\n"
+           "  --format rgba8|rgb8|r8|mask1|v210|rgba16f|i420\n"
+           "                               format of raw input and bars (default rgba8)\n"
+           "  --size WxH                   frame size of raw input and bars (default %ux%u)\n"
+           "  --tile-rows N                rows per tile (default %u)\n"
+           "  --frames N                   frames of bars (default %u), passes over the file\n"
+           "                               with --bench (default 1)\n"
+           "  --bench                      decode FILE on 1, 2, 4... threads up to one per\n"
+           "                               core and print the throughput of each\n",
+           texWidth, texHeight, defaultTileRows, defaultBarsFrames);
+}
+
+uint32_t parseUint(const char *name, const char *value)
+{
+    char *end = nullptr;
+    const unsigned long result = strtoul(value, &end, 10);
+    if (!*value || *end) {
+        printf("Invalid value for %s: %s\n", name, value);
+        exit(1);
+    }
+    return static_cast<uint32_t>(result);
+}
+
+EncoderOptions parseOptions(int argc, char **argv)
+{
+    EncoderOptions options;
+    options.format.width = texWidth;
+    options.format.height = texHeight;
+    std::vector<std::string> files;
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        auto value = [&]() -> const char * {
+            if (i + 1 >= argc) {
+                printf("Missing value for %s\n", arg.c_str());
+                exit(1);
+            }
+            return argv[++i];
+        };
+
+        if (arg == "--format") {
+            const std::string format = value();
+            if (!parsePixelFormat(format, options.format.pixelFormat)) {
+                printf("Unknown format: %s\n", format.c_str());
+                exit(1);
+            }
+        } else if (arg == "--size") {
+            const char *size = value();
+            unsigned width = 0;
+            unsigned height = 0;
+            char end = 0;
+            if (sscanf(size, "%ux%u%c", &width, &height, &end) != 2 || !width || !height) {
+                printf("Invalid value for %s: %s\n", arg.c_str(), size);
+                exit(1);
+            }
+            options.format.width = width;
+            options.format.height = height;
+        } else if (arg == "--tile-rows") {
+            options.tileRows = parseUint(arg.c_str(), value());
+            if (!options.tileRows) {
+                printf("Tiles need at least one row\n");
+                exit(1);
+            }
+        } else if (arg == "--frames") {
+            options.frames = parseUint(arg.c_str(), value());
+        } else if (arg == "--bench") {
+            options.bench = true;
+        } else if (arg == "--help") {
+            printUsage();
+            exit(0);
+        } else if (arg.size() > 2 && arg.compare(0, 2, "--") == 0) {
+            printf("Unknown option: %s\n", arg.c_str());
+            printUsage();
+            exit(1);
+        } else {
+            files.push_back(arg);
+        }
+    }
+    if (files.size() != (options.bench ? 1u : 2u)) {
+        printUsage();
+        exit(1);
+    }
+    options.input = files[0];
+    if (!options.bench) {
+        options.output = files[1];
+    }
+    return options;
+}
+
+int encode(const EncoderOptions &options)
+{
+    std::unique_ptr<FrameSource> source;
+    uint64_t frames = 0;
+    if (options.input == "bars") {
+        source = std::make_unique<BarsSource>(options.format, 1);
+        frames = options.frames ? options.frames : defaultBarsFrames;
+    } else {
+        auto file = std::make_unique<RawFileSource>(options.input, options.format, 1);
+        frames = file->frameCount();
+        source = std::move(file);
+    }
+
+    const FrameFormat &format = source->format();
+    const size_t rowBytes = format.sourceRowBytes();
+    std::vector<uint8_t> frame(format.sourceFrameBytes());
+    TileWriter writer(options.output, format, options.tileRows);
+    const auto start = std::chrono::steady_clock::now();
+    for (uint64_t i = 0; i < frames; ++i) {
+        const uint8_t *data = source->frameData(0, i);
+        if (!data) {
+            source->readFrame(0, i, frame.data(), rowBytes);
+            data = frame.data();
+        }
+        writer.addFrame(data, rowBytes);
+    }
+    writer.finish();
+    const std::chrono::duration<double> seconds = std::chrono::steady_clock::now() - start;
+
+    printf("Wrote %s: %llu %ux%u %s frames, %.1f MB to %.1f MB (%.1f%%) in %.1f s\n",
+           options.output.c_str(), static_cast<unsigned long long>(frames), format.width,
+           format.height, pixelFormatName(format.pixelFormat), writer.inputBytes() / 1e6,
+           writer.outputBytes() / 1e6,
+           writer.inputBytes() ? 100.0 * writer.outputBytes() / writer.inputBytes() : 0.0,
+           seconds.count());
+    return 0;
+}
+
+// decodes every frame as the player would, into a buffer with the row pitch of the arena
+double decodeThroughput(const std::string &path, uint32_t threads, uint32_t passes)
+{
+    TileSource source(path, 1, threads);
+    const FrameFormat &format = source.format();
+    const size_t pitch = (format.rowBytes() + 255) / 256 * 256;
+    std::vector<uint8_t> frame(pitch * format.uploadHeight());
+    // the first pass pages the file in
+    for (uint32_t i = 0; i < source.frameCount(); ++i) {
+        source.readFrame(0, i, frame.data(), pitch);
+    }
+
+    const uint64_t frames = uint64_t{source.frameCount()} * passes;
+    const auto start = std::chrono::steady_clock::now();
+    for (uint64_t i = 0; i < frames; ++i) {
+        source.readFrame(0, i, frame.data(), pitch);
+    }
+    const std::chrono::duration<double> seconds = std::chrono::steady_clock::now() - start;
+    return seconds.count() > 0 ? frames * format.sourceFrameBytes() / 1e9 / seconds.count()
+                               : 0.0;
+}
+
+int bench(const EncoderOptions &options)
+{
+    const uint32_t cores = std::max(1u, std::thread::hardware_concurrency());
+    std::vector<uint32_t> threadCounts;
+    for (uint32_t threads = 1; threads < cores; threads *= 2) {
+        threadCounts.push_back(threads);
+    }
+    threadCounts.push_back(cores);
+
+    const uint32_t passes = std::max(1u, options.frames);
+    double single = 0;
+    for (const uint32_t threads : threadCounts) {
+        const double throughput = decodeThroughput(options.input, threads, passes);
+        if (threads == 1) {
+            single = throughput;
+        }
+        printf("%3u threads: %6.2f GB/s, %.2fx\n", threads, throughput,
+               single > 0 ? throughput / single : 0.0);
+    }
+    return 0;
+}
+} // namespace
+
+int main(int argc, char **argv)
+{
+    const EncoderOptions options = parseOptions(argc, argv);
+    return options.bench ? bench(options) : encode(options);
+}